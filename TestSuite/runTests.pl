@@ -0,0 +1,85 @@
+#!/usr/bin/perl
+=pod
+Copyright (c) 2009-2015, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+Runs ../src/lanczos on each input of inputs/references.txt and
+compares the Energy= it prints with the reference.
+Usage: perl runTests.pl [-l path/to/lanczos] [-f FLAG,FLAG...]
+where the flags (USE_PTHREADS, USE_COMPLEX) are those lanczos was
+built with; inputs that need other flags are skipped.
+=cut
+use warnings;
+use strict;
+
+my $lanczos = "../src/lanczos";
+my %flags;
+my $tolerance = 1e-6;
+
+while (my $arg = shift @ARGV) {
+	if ($arg eq "-l") {
+		$lanczos = shift @ARGV;
+	} elsif ($arg eq "-f") {
+		my $list = shift @ARGV;
+		die "$0: -f needs a list of flags\n" unless defined($list);
+		$flags{$_} = 1 foreach (split(/,/,$list));
+	} else {
+		die "$0: unknown option $arg\n";
+	}
+}
+
+die "$0: $lanczos not found or not executable\n" unless (-x $lanczos);
+
+my ($passed,$failed,$skipped) = (0,0,0);
+open(FILE,"<","inputs/references.txt") or die "$0: cannot open inputs/references.txt: $!\n";
+while (<FILE>) {
+	next if (/^#/ or /^\s*$/);
+	my ($input,$reference,$needs) = split;
+	my @missing = grep { !$flags{$_} } split(/,/,defined($needs) ? $needs : "");
+	if (scalar(@missing) > 0) {
+		print "$input SKIPPED (needs -D".join(" -D",@missing).")\n";
+		$skipped++;
+		next;
+	}
+
+	my $energy = runOne($input);
+	if (defined($energy) and abs($energy - $reference) < $tolerance) {
+		print "$input OK E0=$energy\n";
+		$passed++;
+		next;
+	}
+
+	$energy = "none" unless defined($energy);
+	print "$input FAILED E0=$energy instead of $reference\n";
+	$failed++;
+}
+
+close(FILE);
+
+print "$passed passed, $failed failed, $skipped skipped\n";
+exit(($failed > 0) ? 1 : 0);
+
+sub runOne
+{
+	my ($input) = @_;
+	my $energy;
+	open(PIPE,"$lanczos -f inputs/$input 2>&1 |") or return $energy;
+	while (<PIPE>) {
+		$energy = $1 if (/^Energy=([^\s]+)/);
+	}
+
+	close(PIPE);
+	return ($? == 0) ? $energy : undef;
+}
@@ -0,0 +1,183 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file BandLanczos.h
+ *
+ *  Band Lanczos with deflation: from seeds v_0,...,v_{n-1} builds an
+ *  orthonormal basis Q of the block Krylov space {v, Hv, H^2v, ...},
+ *  the projection T = Q^dagger H Q and the seeds in that basis, R,
+ *  with v_i = Q R(:,i). Seeds or products that are linear combinations
+ *  of earlier vectors are dropped (deflated), so the blocks may shrink.
+ *
+ *  Then <v_i|(z-H)^{-1}|v_j> = R(:,i)^dagger (z-T)^{-1} R(:,j)
+ *                            = sum_k conj(a(k,i)) a(k,j)/(z-e_k)
+ *  with T = U diag(e) U^dagger and a = U^dagger R, for all i and j
+ *  at once.
+ *
+ *  T is banded: H q_k has no component along q_j once H q_j has been
+ *  taken, unless the new vectors of H q_j reach past k. Only the
+ *  vectors still coupled to the coming ones are kept, at most about
+ *  2n of them, and the products are orthogonalized (twice) against
+ *  those only. As in the Lanczos of the continued fractions, there is
+ *  no reorthogonalization against older vectors, so converged poles may
+ *  come out repeated, with their weight shared among the copies.
+ */
+#ifndef BAND_LANCZOS_H
+#define BAND_LANCZOS_H
+#include "Vector.h"
+#include "Matrix.h"
+
+namespace LanczosPlusPlus {
+
+template<typename SomeMatrixType,typename VectorType>
+class BandLanczos {
+
+	typedef typename VectorType::value_type ComplexOrRealType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
+
+public:
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	// The Krylov space stops growing at maxKrylov vectors
+	BandLanczos(const SomeMatrixType& matrix,SizeType maxKrylov)
+	    : matrix_(matrix),maxKrylov_(maxKrylov)
+	{
+		if (maxKrylov_ > matrix_.rank()) maxKrylov_ = matrix_.rank();
+	}
+
+	// Upper bound of the memory used by decomposition, the seeds included
+	static size_t bytes(SizeType hilbert,SizeType nseeds,SizeType maxKrylov)
+	{
+		size_t vectors = static_cast<size_t>(3*nseeds + 2)*hilbert;
+		size_t small = static_cast<size_t>(maxKrylov)*(2*maxKrylov + 2*nseeds);
+		return (vectors + small)*sizeof(ComplexOrRealType);
+	}
+
+	void decomposition(const VectorVectorType& seeds)
+	{
+		SizeType hilbert = matrix_.rank();
+		SizeType nseeds = seeds.size();
+		MatrixType t(maxKrylov_,maxKrylov_);
+		MatrixType r(maxKrylov_,nseeds);
+		// q_first,...,q_{m-1}; H q_k is in the span of q_0,...,q_{reach[k]-1}
+		VectorVectorType q;
+		SizeType first = 0;
+		SizeType m = 0;
+		typename PsimagLite::Vector<SizeType>::Type reach;
+		VectorType overlaps;
+		RealType beta = 0.0;
+
+		for (SizeType i=0;i<nseeds;i++) {
+			VectorType c = seeds[i];
+			bool added = orthogonalize(q,m,overlaps,beta,c);
+			for (SizeType j=0;j<overlaps.size();j++)
+				r(j,i) = overlaps[j];
+			if (added) r(m-1,i) = beta;
+		}
+
+		// Every vector is multiplied by H, also when the space is full,
+		// so that t is the whole projection of H
+		for (SizeType k=0;k<m;k++) {
+			while (first < k && reach[first] <= k) {
+				q.erase(q.begin());
+				first++;
+			}
+
+			VectorType c(hilbert,0.0);
+			matrix_.matrixVectorProduct(c,q[k-first]);
+			bool added = orthogonalize(q,m,overlaps,beta,c);
+			for (SizeType j=0;j<overlaps.size();j++)
+				t(first+j,k) = overlaps[j];
+			if (added) t(m-1,k) = beta;
+			reach.push_back(m);
+		}
+
+		q.clear();
+		MatrixType u(m,m);
+		for (SizeType j=0;j<m;j++)
+			for (SizeType k=0;k<m;k++)
+				u(j,k) = 0.5*(t(j,k) + PsimagLite::conj(t(k,j)));
+
+		poles_.resize(m);
+		if (m > 0) diag(u,poles_,'V');
+
+		amplitudes_.resize(m,nseeds);
+		for (SizeType k=0;k<m;k++) {
+			for (SizeType i=0;i<nseeds;i++) {
+				ComplexOrRealType sum = 0.0;
+				for (SizeType j=0;j<m;j++)
+					sum += PsimagLite::conj(u(j,k))*r(j,i);
+				amplitudes_(k,i) = sum;
+			}
+		}
+	}
+
+	// The eigenvalues e_k of T
+	const VectorRealType& poles() const { return poles_; }
+
+	// amplitudes()(k,i) is the amplitude of seed i on pole k
+	const MatrixType& amplitudes() const { return amplitudes_; }
+
+private:
+
+	// Removes from c its components along q, in two passes, and puts
+	// them in overlaps. Appends c, normalized by beta, to q unless it
+	// is deflated or the m vectors made so far fill the space
+	bool orthogonalize(VectorVectorType& q,
+	                   SizeType& m,
+	                   VectorType& overlaps,
+	                   RealType& beta,
+	                   VectorType& c) const
+	{
+		overlaps.assign(q.size(),0.0);
+		for (SizeType pass=0;pass<2;pass++) {
+			for (SizeType j=0;j<q.size();j++) {
+				ComplexOrRealType h = 0.0;
+				for (SizeType i=0;i<c.size();i++)
+					h += PsimagLite::conj(q[j][i])*c[i];
+				for (SizeType i=0;i<c.size();i++)
+					c[i] -= h*q[j][i];
+				overlaps[j] += h;
+			}
+		}
+
+		RealType sum = 0.0;
+		for (SizeType i=0;i<c.size();i++)
+			sum += PsimagLite::norm(c[i]);
+		beta = sqrt(sum);
+		if (beta < 1e-10 || m == maxKrylov_) return false;
+
+		for (SizeType i=0;i<c.size();i++)
+			c[i] /= beta;
+		q.push_back(c);
+		m++;
+		return true;
+	}
+
+	const SomeMatrixType& matrix_;
+	SizeType maxKrylov_;
+	VectorRealType poles_;
+	MatrixType amplitudes_;
+}; // class BandLanczos
+} // namespace LanczosPlusPlus
+
+#endif  // BAND_LANCZOS_H
@@ -35,8 +35,16 @@ public:
 	typedef ProgramGlobals::WordType WordType;
 	typedef typename PsimagLite::Vector<WordType>::Type VectorWordType;
 
+	// Each basis gets its own id, so that caches are not fooled by a
+	// new basis allocated at the address of a deleted one
+	BasisBase() : id_(counter_++) {}
+
+	BasisBase(const BasisBase&) : id_(counter_++) {}
+
 	virtual ~BasisBase() {}
 
+	SizeType id() const { return id_; }
+
 	virtual SizeType dofs() const = 0;
 
 	virtual SizeType size() const = 0;
@@ -107,8 +115,19 @@ public:
 	                    SizeType) const = 0;
 
 	virtual void print(std::ostream&,PrintEnum) const = 0;
+
+private:
+
+	BasisBase& operator=(const BasisBase&);
+
+	static SizeType counter_;
+	SizeType id_;
 }; // class BasisBase
 
+// Bases are created by the main thread only
+template<typename GeometryType>
+SizeType BasisBase<GeometryType>::counter_ = 0;
+
 } // namespace LanczosPlusPlus
 #endif
 
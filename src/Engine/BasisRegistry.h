@@ -0,0 +1,101 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file BasisRegistry.h
+ *
+ *  Bases shared by their numbers of electrons (nup,ndown); a basis is
+ *  built on the first acquire and deleted on the last release
+ *
+ */
+#ifndef BASIS_REGISTRY_H
+#define BASIS_REGISTRY_H
+#include "Vector.h"
+
+namespace LanczosPlusPlus {
+
+template<typename BasisType>
+class BasisRegistry {
+
+	typedef std::pair<SizeType,SizeType> PairType;
+
+	struct Entry {
+		PairType parts;
+		BasisType* basis;
+		SizeType references;
+	};
+
+	typedef typename PsimagLite::Vector<Entry>::Type VectorEntryType;
+
+public:
+
+	BasisRegistry() {}
+
+	~BasisRegistry()
+	{
+		for (SizeType i=0;i<entries_.size();i++)
+			delete entries_[i].basis;
+	}
+
+	// The basis for parts, with one more reference, or 0 if there is none
+	const BasisType* acquire(const PairType& parts)
+	{
+		for (SizeType i=0;i<entries_.size();i++) {
+			if (entries_[i].parts != parts) continue;
+			entries_[i].references++;
+			return entries_[i].basis;
+		}
+
+		return 0;
+	}
+
+	// Takes ownership of basis, with one reference
+	const BasisType* insert(const PairType& parts,BasisType* basis)
+	{
+		Entry entry;
+		entry.parts = parts;
+		entry.basis = basis;
+		entry.references = 1;
+		entries_.push_back(entry);
+		return basis;
+	}
+
+	void release(const BasisType* basis)
+	{
+		for (SizeType i=0;i<entries_.size();i++) {
+			if (entries_[i].basis != basis) continue;
+			if (--entries_[i].references > 0) return;
+			delete entries_[i].basis;
+			entries_.erase(entries_.begin() + i);
+			return;
+		}
+
+		throw PsimagLite::RuntimeError("BasisRegistry: release of unknown basis\n");
+	}
+
+private:
+
+	BasisRegistry(const BasisRegistry&);
+
+	BasisRegistry& operator=(const BasisRegistry&);
+
+	VectorEntryType entries_;
+}; // class BasisRegistry
+} // namespace LanczosPlusPlus
+
+#endif  // BASIS_REGISTRY_H
@@ -0,0 +1,100 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file BondList.h
+ *
+ *  Nonzero couplings of one term, grouped by origin.
+ *
+ *  Models fill it once at construction, one origin at a time (an
+ *  origin is a site, or a site and orbital), so that row generators
+ *  visit only the bonds that exist instead of all pairs of sites.
+ *  Each bond keeps the other end, the amplitude, and the combined
+ *  bit mask of both ends.
+ */
+#ifndef BOND_LIST_H
+#define BOND_LIST_H
+#include "Vector.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ComplexOrRealType,typename WordType>
+class BondList {
+
+public:
+
+	struct Bond {
+
+		Bond(SizeType site_,
+		     SizeType orb_,
+		     WordType mask_,
+		     const ComplexOrRealType& value_)
+		    : site(site_),orb(orb_),mask(mask_),value(value_)
+		{}
+
+		SizeType site;
+		SizeType orb;
+		WordType mask;
+		ComplexOrRealType value;
+	};
+
+	BondList() : start_(1,0) {}
+
+	// Adds a bond to the current origin; zero couplings are dropped
+	void push(SizeType site,
+	          SizeType orb,
+	          WordType mask,
+	          const ComplexOrRealType& value)
+	{
+		if (PsimagLite::real(value) == 0 && PsimagLite::imag(value) == 0) return;
+		bonds_.push_back(Bond(site,orb,mask,value));
+	}
+
+	// Closes the current origin; the next push starts the next one
+	void closeOrigin() { start_.push_back(bonds_.size()); }
+
+	SizeType origins() const { return start_.size() - 1; }
+
+	SizeType begin(SizeType origin) const
+	{
+		assert(origin + 1 < start_.size());
+		return start_[origin];
+	}
+
+	SizeType end(SizeType origin) const
+	{
+		assert(origin + 1 < start_.size());
+		return start_[origin + 1];
+	}
+
+	const Bond& operator()(SizeType k) const
+	{
+		assert(k < bonds_.size());
+		return bonds_[k];
+	}
+
+	SizeType size() const { return bonds_.size(); }
+
+private:
+
+	PsimagLite::Vector<SizeType>::Type start_;
+	typename PsimagLite::Vector<Bond>::Type bonds_;
+}; // class BondList
+} // namespace LanczosPlusPlus
+#endif // BOND_LIST_H
+
@@ -23,6 +23,7 @@ Please see full open source license included in file LICENSE.
 #include "CrsMatrix.h"
 #include "Vector.h"
 #include "Matrix.h"
+#include "Concurrency.h"
 
 namespace LanczosPlusPlus {
 
@@ -34,6 +35,7 @@ class DefaultSymmetry  {
 	typedef ProgramGlobals::WordType WordType;
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
 
 public:
 
@@ -101,20 +103,78 @@ public:
 	{
 	}
 
+	void transformToSector(VectorType& dest,const VectorType& src,SizeType) const
+	{
+		dest = src;
+	}
+
+	ComplexOrRealType realSpaceComponent(const VectorType& v,SizeType,SizeType ispace) const
+	{
+		return v[ispace];
+	}
+
 	SizeType sectors() const { return 1; }
 
+	// Stored elements, for the memory estimate of the sector cache
+	SizeType nonZeros() const { return matrixStored_.nonZeros(); }
+
 	void setPointer(SizeType) { }
 
 	PsimagLite::String name() const { return "default"; }
 
 	SizeType rank() const { return matrixStored_.row(); }
 
+	SizeType rank(SizeType) const { return matrixStored_.row(); }
+
 	template<typename SomeVectorType>
 	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
 	{
 		return matrixStored_.matrixVectorProduct(x,y);
 	}
 
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y,SizeType) const
+	{
+		return matrixStored_.matrixVectorProduct(x,y);
+	}
+
+	// On the fly there is a single sector, and the model does x += H y
+	template<typename SomeModelType>
+	void initOnTheFly(const SomeModelType&,const BasisType&) {}
+
+	// model.size() may be smaller than its basis (TjMultiOrb truncates)
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType& model,const BasisType& basis) const
+	{
+		return (&basis == &model.basis()) ? model.size() : basis.size();
+	}
+
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType& model,const BasisType& basis,SizeType) const
+	{
+		return rank(model,basis);
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis) const
+	{
+		model.matrixVectorProduct(x,y,basis,ConcurrencyType::npthreads);
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis,
+	                         SizeType,
+	                         SizeType threads) const
+	{
+		model.matrixVectorProduct(x,y,basis,threads);
+	}
+
 private:
 
 	SparseMatrixType matrixStored_;
@@ -0,0 +1,118 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file DiagonalCache.h
+ *
+ *  Diagonal of the Hamiltonian for the last basis it was asked for.
+ *
+ *  The on-the-fly products need the diagonal at every Lanczos step;
+ *  it is computed once per basis, with threads, from the model's
+ *  RealType diagonalElement(SizeType,const BasisBaseType&) const
+ *  and kept until a different basis is asked for. Bases are told
+ *  apart by BasisBase::id(), not by address, since a released basis
+ *  can be followed by a new one at the same address.
+ */
+#ifndef DIAGONAL_CACHE_H
+#define DIAGONAL_CACHE_H
+#include "Vector.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename RealType,typename BasisBaseType>
+class DiagonalCache {
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	template<typename ModelType>
+	class DiagonalHelper {
+
+	public:
+
+		DiagonalHelper(VectorRealType& diag,
+		               const ModelType& model,
+		               const BasisBaseType& basis)
+		    : diag_(diag),model_(model),basis_(basis)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType ispace = threadNum*blockSize + p;
+				if (ispace>=total) break;
+				diag_[ispace] = model_.diagonalElement(ispace,basis_);
+			}
+		}
+
+	private:
+
+		VectorRealType& diag_;
+		const ModelType& model_;
+		const BasisBaseType& basis_;
+	}; // class DiagonalHelper
+
+public:
+
+	DiagonalCache() : id_(0),valid_(false) {}
+
+	template<typename ModelType>
+	const VectorRealType& operator()(const ModelType& model,
+	                                 const BasisBaseType& basis)
+	{
+		return operator()(model,basis,ConcurrencyType::npthreads);
+	}
+
+	template<typename ModelType>
+	const VectorRealType& operator()(const ModelType& model,
+	                                 const BasisBaseType& basis,
+	                                 SizeType threads)
+	{
+		SizeType hilbert = basis.size();
+		if (valid_ && id_ == basis.id())
+			return diag_;
+
+		valid_ = false;
+		diag_.clear();
+		diag_.resize(hilbert,0.0);
+
+		typedef DiagonalHelper<ModelType> HelperType;
+		typedef PsimagLite::Parallelizer<HelperType> ParallelizerType;
+		HelperType helper(diag_,model,basis);
+		ParallelizerType threadObject(threads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(hilbert,helper);
+
+		id_ = basis.id();
+		valid_ = true;
+		return diag_;
+	}
+
+private:
+
+	SizeType id_;
+	bool valid_;
+	VectorRealType diag_;
+}; // class DiagonalCache
+} // namespace LanczosPlusPlus
+#endif // DIAGONAL_CACHE_H
+
@@ -21,6 +21,7 @@ Please see full open source license included in file LICENSE.
 #ifndef ENGINE_H_
 #define ENGINE_H_
 #include <iostream>
+#include <list>
 #include "ProgressIndicator.h"
 #include "BLAS.h"
 #include "LanczosSolver.h"
@@ -28,7 +29,12 @@ Please see full open source license included in file LICENSE.
 #include "ProgramGlobals.h"
 #include "ParametersForSolver.h"
 #include "DefaultSymmetry.h"
+#include "SectorExpansion.h"
+#include "BandLanczos.h"
+#include "KernelPolynomial.h"
 #include "TypeToString.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
 
 namespace LanczosPlusPlus {
 template<typename ModelType_,
@@ -67,33 +73,72 @@ public:
 	typedef std::pair<SizeType,SizeType> PairType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
 	typedef typename PsimagLite::Vector<PsimagLite::String>::Type VectorStringType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+	typedef typename PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
 
 	// ContF needs to support concurrency FIXME
 	static const SizeType parallelRank_ = 0;
 	static const SizeType CHECK_HERMICITY = 1;
+	static const SizeType EARLY_STOP_STEPS = 20;
+	static const SizeType KPM_BOUND_STEPS = 40;
 
 	enum {PLUS,MINUS};
 
+	// extraOptions are added to SolverOptions, as found by SymmetryDetector
 	Engine(const ModelType& model,
 	       SizeType,
-	       InputType& io)
+	       InputType& io,
+	       PsimagLite::String extraOptions = "")
 	    : model_(model),
 	      progress_("Engine"),
 	      io_(io),
-	      options_("")
+	      options_(""),
+	      gsSymmetry_(0),
+	      gsSector_(0),
+	      cacheBudget_(0),
+	      cacheBytes_(0),
+	      cacheClock_(0)
 	{
 		io_.readline(options_,"SolverOptions=");
+		if (extraOptions != "") options_ += "," + extraOptions;
+
+		SizeType megabytes = 1024;
+		try {
+			io_.readline(megabytes,"SpectralCacheMegabytes=");
+		} catch (std::exception&) {}
+
+		// size_t, as SizeType may be 32 bits
+		cacheBudget_ = static_cast<size_t>(megabytes)*1048576;
+
 		computeGroundState();
 	}
 
+	~Engine()
+	{
+		delete gsSymmetry_;
+		typename ListCachedSectorType::iterator it = cache_.begin();
+		for (;it!=cache_.end();++it)
+			deleteSector(*it);
+	}
+
 	RealType gsEnergy() const
 	{
 		return gsEnergy_;
 	}
 
+	// With GsInSector the real-space vector is only made when asked for
 	const VectorType& eigenvector() const
 	{
-		return gsVector_;
+		if (!gsSymmetry_) return gsVector_;
+		if (gsRealSpace_.size() == 0)
+			SectorExpansion<SpecialSymmetryType>::expand(gsRealSpace_,
+			                                             gsVector_,
+			                                             *gsSymmetry_,
+			                                             gsSector_,
+			                                             model_.basis().size());
+		return gsRealSpace_;
 	}
 
 	//! Calc Green function G(isite,jsite)  (still diagonal in spin)
@@ -116,6 +161,15 @@ public:
 	/* PSIDOC SpectralFunctions
 	Here we document the spectral functions and Green function G(isite,jsite)  
 	(still diagonal in spin)
+	The Lanczos for the excited states runs in each sector of the special
+	symmetry, on the component of the modified vector in that sector, and
+	each sector adds its own continued fraction, labeled
+	spin,type,orb1,orb2,sector. If the symmetry does not apply to the
+	excited states (SpinFlip when nup differs from ndown) there is a single
+	fraction, labeled spin,type,orb1,orb2.
+	The basis, symmetry and Hamiltonian of each excited sector are built once
+	and kept for later calls; the least recently used are freed when their
+	estimated size goes over SpectralCacheMegabytes= (default 1024).
 	*/
 	template<typename ContinuedFractionCollectionType>
 	void spectralFunction(ContinuedFractionCollectionType& cfCollection,
@@ -133,52 +187,170 @@ public:
 			throw std::runtime_error(str.c_str());
 		}
 
-		typedef typename ContinuedFractionCollectionType::ContinuedFractionType
-		        ContinuedFractionType;
-
-		const BasisType* basisNew = 0;
 		bool isDiagonal = (isite==jsite && orbs.first==orbs.second);
 
 		for (SizeType type=0;type<4;type++) {
 			if (isDiagonal && type>1) continue;
 
-			SizeType operatorLabel= (type&1) ?  what2 : ProgramGlobals::transposeConjugate(what2);
-			if (ProgramGlobals::needsNewBasis(operatorLabel)) {
-				assert(spins.first==spins.second);
-				std::pair<SizeType,SizeType> newParts(0,0);
-				if (!model_.hasNewParts(newParts,operatorLabel,spins.first,orbs)) continue;
-				// Create new bases
-				basisNew = model_.createBasis(newParts.first,newParts.second);
-			} else {
-				basisNew = &model_.basis();
-			}
+			SizeType operatorLabel = 0;
 			VectorType modifVector;
-			getModifiedState(modifVector,
-			                 operatorLabel,
-			                 gsVector_,
-			                 *basisNew,
-			                 type,
-			                 isite,
-			                 jsite,
-			                 spins.first,
-			                 orbs);
-
-			DefaultSymmetryType symm(*basisNew,model_.geometry(),"");
-			InternalProductTemplate<ModelType,DefaultSymmetryType> matrix(model_,
-			                                                              *basisNew,
-			                                                              symm);
-			ContinuedFractionType cf(cfCollection.freqType());
+			const CachedSector* sector = modifiedSector(modifVector,
+			                                            operatorLabel,
+			                                            what2,
+			                                            type,
+			                                            isite,
+			                                            jsite,
+			                                            spins.first,
+			                                            orbs);
+			if (!sector) continue;
 
-			if (PsimagLite::norm(modifVector)<1e-10) {
-				std::cerr<<"spectralFunction: modifVector==0, type="<<type<<"\n";
+			PsimagLite::String str = ttos(spins.first) + "," + ttos(type) + ",";
+			str += ttos(orbs.first) + "," + ttos(orbs.second);
+
+			if (sector->symm) {
+				spectralInSectors(cfCollection,vstr,str,*sector->symm,*sector->matrix,
+				                  operatorLabel,modifVector,type,spins.first,isDiagonal);
+				continue;
 			}
 
-			calcSpectral(cf,operatorLabel,modifVector,matrix,type,spins.first,isDiagonal);
-			PsimagLite::String str = ttos(spins.first) + "," + ttos(type) + ",";
+			spectralInSectors(cfCollection,vstr,str,*sector->symmDefault,
+			                  *sector->matrixDefault,operatorLabel,modifVector,
+			                  type,spins.first,isDiagonal);
+		}
+	}
+
+	void kernelPolynomial(std::ostream& os,
+	                      SizeType what2,
+	                      int isite,
+	                      int jsite,
+	                      const PsimagLite::Vector<PairType>::Type& spins,
+	                      const PairType& orbs) const
+	{
+		for (SizeType i=0;i<spins.size();i++) {
+			if (spins[i].first != spins[i].second) {
+				PsimagLite::String str(__FILE__);
+				str += " " + ttos(__LINE__) + "\n";
+				str += "kernelPolynomial: no support yet for off-diagonal spin\n";
+				throw std::runtime_error(str.c_str());
+			}
+
+			kernelPolynomial(os,what2,isite,jsite,spins[i].first,orbs);
+		}
+	}
+
+	/* PSIDOC KernelPolynomial
+	The spectral functions of G(isite,jsite) as in spectralFunction, from
+	the kernel polynomial method instead of a continued fraction, for each
+	type and sector. Each prints \#KernelPolynomial label sign weight
+	scale shift moments, with the label as in spectralFunction, the damped
+	moments one per line, and then \#Spectrum and lines $\omega$ $A(\omega)$
+	at the Chebyshev nodes. $\omega$ is measured from the ground state
+	energy, with the sign of the part, and $A(\omega)$ already includes the
+	weight. The moments are those of $(H-shift)/scale$ in the excited sector.
+	KpmMoments= (default 256) sets the number of moments, KpmKernel= is
+	Jackson (default) or Lorentz, and KpmLambda= (default 4) is the
+	parameter of the Lorentz kernel. Memory is three vectors per run,
+	whatever the number of moments.
+	*/
+	void kernelPolynomial(std::ostream& os,
+	                      SizeType what2,
+	                      int isite,
+	                      int jsite,
+	                      SizeType spin,
+	                      const PairType& orbs) const
+	{
+		bool isDiagonal = (isite==jsite && orbs.first==orbs.second);
+
+		for (SizeType type=0;type<4;type++) {
+			if (isDiagonal && type>1) continue;
+
+			SizeType operatorLabel = 0;
+			VectorType modifVector;
+			const CachedSector* sector = modifiedSector(modifVector,
+			                                            operatorLabel,
+			                                            what2,
+			                                            type,
+			                                            isite,
+			                                            jsite,
+			                                            spin,
+			                                            orbs);
+			if (!sector) continue;
+
+			PsimagLite::String str = ttos(spin) + "," + ttos(type) + ",";
 			str += ttos(orbs.first) + "," + ttos(orbs.second);
-			vstr.push_back(str);
-			cfCollection.push(cf);
+
+			if (sector->symm) {
+				kpmInSectors(os,str,*sector->symm,*sector->matrix,
+				             operatorLabel,modifVector,type,isDiagonal);
+				continue;
+			}
+
+			kpmInSectors(os,str,*sector->symmDefault,*sector->matrixDefault,
+			             operatorLabel,modifVector,type,isDiagonal);
+		}
+	}
+
+	/* PSIDOC DensityOfStates
+	The density of states per state of the Hamiltonian of the ground state
+	sector, $\rho(E)=Tr\,\delta(E-H)/D$, from the kernel polynomial method
+	with KpmRandomVectors= (default 16) random vectors of phases $\pm 1$
+	in each sector of the special symmetry. The random vectors run
+	concurrently, each with three vectors of memory. It prints
+	\#DensityOfStates vectors dimension scale shift moments, the
+	damped moments, \#Spectrum and lines E $\rho(E)$ at the Chebyshev nodes.
+	The options of KernelPolynomial apply.
+	*/
+	void densityOfStates(std::ostream& os) const
+	{
+		SizeType totalMoments = 0;
+		PsimagLite::String kernel;
+		RealType lambda = 0;
+		kpmOptions(totalMoments,kernel,lambda);
+
+		SizeType vectors = 16;
+		try {
+			io_.readline(vectors,"KpmRandomVectors=");
+		} catch (std::exception&) {}
+
+		SpecialSymmetryType rs(model_.basis(),model_.geometry(),spectralOptions());
+		InternalProductType hamiltonian(model_,rs);
+
+		// One scale for all sectors, so that their moments add up
+		SizeType sectors = rs.sectors();
+		RealType emin = 0.0;
+		RealType emax = 0.0;
+		bool first = true;
+		for (SizeType p=0;p<sectors;p++) {
+			SectorMatrix matrix(hamiltonian,p,ConcurrencyType::npthreads);
+			if (matrix.rank() == 0) continue;
+			VectorType v;
+			randomVector(v,matrix.rank(),p*vectors);
+			RealType e1 = 0.0;
+			RealType e2 = 0.0;
+			KernelPolynomial<SectorMatrix,VectorType>::bounds(e1,e2,matrix,v,KPM_BOUND_STEPS);
+			if (first || e1 < emin) emin = e1;
+			if (first || e2 > emax) emax = e2;
+			first = false;
 		}
+
+		VectorVectorRealType moments(sectors*vectors);
+		typedef PsimagLite::Parallelizer<DensityOfStatesHelper> ParallelizerType;
+		DensityOfStatesHelper helper(hamiltonian,emin,emax,vectors,totalMoments,moments);
+		ParallelizerType threadObject(ConcurrencyType::npthreads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(sectors*vectors,helper);
+
+		VectorRealType mu(totalMoments,0.0);
+		SizeType dimension = model_.basis().size();
+		for (SizeType i=0;i<moments.size();i++)
+			for (SizeType n=0;n<moments[i].size();n++)
+				mu[n] += moments[i][n]/(vectors*dimension);
+
+		SectorMatrix matrix(hamiltonian,0,ConcurrencyType::npthreads);
+		KernelPolynomial<SectorMatrix,VectorType> kpm(matrix,emin,emax);
+		KernelPolynomial<SectorMatrix,VectorType>::damp(mu,kernel,lambda);
+		os<<"#DensityOfStates "<<vectors<<" "<<dimension<<" "<<kpm.scaleFactor();
+		os<<" "<<kpm.shift()<<" "<<totalMoments<<"\n";
+		printKpm(os,kpm,mu,1.0,0.0,1.0);
 	}
 
 	void twoPoint(PsimagLite::Matrix<typename VectorType::value_type>& result,
@@ -249,10 +421,385 @@ public:
 			}
 		}
 		std::cout<<"MatrixDiagonal = "<<sum<<"\n";
+		if (basisNew != &model_.basis()) model_.releaseBasis(basisNew);
+	}
+
+	/* PSIDOC MomentumSpectral
+	The spectral function A(k,$\omega$) for each $k=2\pi m/L$, with the
+	site index as position, from the Lanczos of $c_k|gs\rangle$ with
+	$c_k=\sum_r e^{ikr}c_r/\sqrt{L}$, one for the particle part (type 0,
+	with $c_k^\dagger$) and one for the hole part (type 1), in each sector
+	of the special symmetry. Fractions are labeled spin,type,orb,m and a
+	sector if there is more than one. With real numbers the phases
+	$\cos(kr)$ and $\sin(kr)$ take one fraction each, labeled
+	spin,type,orb,m,cos and spin,type,orb,m,sin, whose sum is A(k,$\omega$)
+	when the Hamiltonian is real.
+	*/
+	template<typename ContinuedFractionCollectionType>
+	void spectralFunctionK(ContinuedFractionCollectionType& cfCollection,
+	                       VectorStringType& vstr,
+	                       SizeType what2,
+	                       SizeType spin,
+	                       SizeType orb) const
+	{
+		SizeType n = model_.geometry().numberOfSites();
+		SizeType parts = phaseParts(ComplexOrRealType());
+		PsimagLite::String partName[] = {"cos","sin"};
+
+		for (SizeType type=0;type<2;type++) {
+			SizeType operatorLabel= (type&1) ?  what2 : ProgramGlobals::transposeConjugate(what2);
+			bool newBasis = ProgramGlobals::needsNewBasis(operatorLabel);
+			PairType newParts(0,0);
+			if (newBasis && !model_.hasNewParts(newParts,operatorLabel,spin,PairType(orb,orb)))
+				continue;
+
+			const CachedSector& sector = cachedSector(newParts,newBasis);
+			RealType sign = (type&1) ? 1.0 : -1.0;
+			for (SizeType m=0;m<n;m++) {
+				for (SizeType part=0;part<parts;part++) {
+					VectorType modifVector(sector.basis->size(),0.0);
+					for (SizeType r=0;r<n;r++) {
+						if (orb >= model_.orbitals(r)) continue;
+						ComplexOrRealType phase = 0.0;
+						setPhase(phase,sign*2*M_PI*m*r/RealType(n),part);
+						accModifiedState(modifVector,operatorLabel,*sector.basis,
+						                 gsVector_,r,spin,orb,phase/sqrt(RealType(n)));
+					}
+
+					if (PsimagLite::norm(modifVector)<1e-10) continue;
+
+					PsimagLite::String str = ttos(spin) + "," + ttos(type) + ",";
+					str += ttos(orb) + "," + ttos(m);
+					if (parts > 1) str += "," + partName[part];
+
+					if (sector.symm) {
+						spectralInSectors(cfCollection,vstr,str,*sector.symm,*sector.matrix,
+						                  operatorLabel,modifVector,type,spin,true);
+						continue;
+					}
+
+					spectralInSectors(cfCollection,vstr,str,*sector.symmDefault,
+					                  *sector.matrixDefault,operatorLabel,modifVector,
+					                  type,spin,true);
+				}
+			}
+		}
+	}
+
+	/* PSIDOC GreenMatrix
+	The Green function G(i,j) for all pairs of sites and orbitals at once,
+	from band Lanczos seeded with what2 and its transpose conjugate on
+	every site and orbital, one run per part and sector. The
+	seeds are numbered as in the \#GreenIndex line, seed site orbital. Each
+	part prints \#GreenPart type sector poles seeds, with type 0 for the
+	transpose conjugate of what2 and type 1 for what2, and then one line
+	per pole, $\omega_k$ followed by the amplitudes $a_{k,0}, a_{k,1},\ldots$
+	of the seeds. Type 0 adds $\sum_k a^*_{k,i}a_{k,j}/(\omega-\omega_k+i\eta)$
+	and type 1 adds $\sum_k a^*_{k,j}a_{k,i}/(\omega-\omega_k+i\eta)$ to
+	$G_{ij}(\omega)$. The Krylov space holds up to Spectral steps times
+	the number of seeds vectors, of which only about twice the number of
+	seeds are kept in memory. If that, the seeds and the projected
+	Hamiltonian go over GreenMegabytes= (default 1024) the Krylov space is
+	made smaller, and the run stops if the vectors alone do not fit.
+	*/
+	void greenMatrix(std::ostream& os,SizeType what2,SizeType spin) const
+	{
+		typedef typename PsimagLite::Vector<PairType>::Type VectorPairType;
+
+		VectorPairType seedIndex;
+		os<<"#GreenIndex";
+		for (SizeType site=0;site<model_.geometry().numberOfSites();site++) {
+			for (SizeType orb=0;orb<model_.orbitals(site);orb++) {
+				os<<" "<<seedIndex.size()<<" "<<site<<" "<<orb;
+				seedIndex.push_back(PairType(site,orb));
+			}
+		}
+
+		os<<"\n";
+
+		ParametersForSolverType params(io_,"Spectral");
+		SizeType megabytes = 1024;
+		try {
+			io_.readline(megabytes,"GreenMegabytes=");
+		} catch (std::exception&) {}
+
+		size_t budget = static_cast<size_t>(megabytes)*1048576;
+		for (SizeType type=0;type<2;type++) {
+			SizeType operatorLabel= (type&1) ?  what2 : ProgramGlobals::transposeConjugate(what2);
+			bool newBasis = ProgramGlobals::needsNewBasis(operatorLabel);
+			PairType newParts(0,0);
+			if (newBasis && !greenParts(newParts,operatorLabel,spin,seedIndex))
+				continue;
+
+			const CachedSector& sector = cachedSector(newParts,newBasis);
+			VectorVectorType seeds(seedIndex.size());
+			for (SizeType i=0;i<seeds.size();i++) {
+				seeds[i].resize(sector.basis->size(),0.0);
+				accModifiedState(seeds[i],operatorLabel,*sector.basis,gsVector_,
+				                 seedIndex[i].first,spin,seedIndex[i].second,1.0);
+			}
+
+			SizeType maxKrylov = params.steps*seeds.size();
+			if (sector.symm) {
+				greenInSectors(os,*sector.symm,*sector.matrix,seeds,type,maxKrylov,budget);
+				continue;
+			}
+
+			greenInSectors(os,*sector.symmDefault,*sector.matrixDefault,seeds,type,
+			               maxKrylov,budget);
+		}
 	}
 
 private:
 
+	// A basis of the excited states with its symmetry and Hamiltonian;
+	// only one of symm and symmDefault is set
+	struct CachedSector {
+		PairType parts;
+		bool newBasis;
+		const BasisType* basis;
+		SpecialSymmetryType* symm;
+		InternalProductType* matrix;
+		DefaultSymmetryType* symmDefault;
+		InternalProductDefaultType* matrixDefault;
+		size_t bytes;
+		SizeType lastUse;
+	};
+
+	// a list, so that eviction does not move the other sectors
+	typedef std::list<CachedSector> ListCachedSectorType;
+
+	// Sector p of the Hamiltonian, whatever its current sector is, with
+	// products on threads threads
+	class SectorMatrix {
+
+	public:
+
+		SectorMatrix(const InternalProductType& hamiltonian,SizeType p,SizeType threads)
+		    : hamiltonian_(hamiltonian),p_(p),threads_(threads)
+		{}
+
+		SizeType rank() const { return hamiltonian_.rank(p_); }
+
+		template<typename SomeVectorType>
+		void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y) const
+		{
+			hamiltonian_.matrixVectorProduct(x,y,p_,threads_);
+		}
+
+	private:
+
+		const InternalProductType& hamiltonian_;
+		SizeType p_;
+		SizeType threads_;
+	}; // class SectorMatrix
+
+	typedef PsimagLite::LanczosSolver<ParametersForSolverType,
+	                                  SectorMatrix,
+	                                  VectorType> SectorLanczosSolverType;
+
+	// Lowest eigenpair of each sector not skipped; a sector whose
+	// Lanczos fails is marked and left for fullDiag
+	class SectorGroundStateHelper {
+
+	public:
+
+		SectorGroundStateHelper(const InternalProductType& hamiltonian,
+		                        SizeType productThreads,
+		                        const ParametersForSolverType& params,
+		                        const VectorSizeType& skip,
+		                        VectorRealType& energies,
+		                        VectorVectorType& vectors,
+		                        VectorSizeType& failed)
+		    : hamiltonian_(hamiltonian),
+		      productThreads_(productThreads),
+		      params_(params),
+		      skip_(skip),
+		      energies_(energies),
+		      vectors_(vectors),
+		      failed_(failed)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			for (SizeType i=0;i<blockSize;i++) {
+				SizeType p = threadNum*blockSize + i;
+				if (p>=total) break;
+				if (skip_[p]) continue;
+				SectorMatrix matrix(hamiltonian_,p,productThreads_);
+				if (matrix.rank() == 0) continue;
+				vectors_[p].resize(matrix.rank());
+				SectorLanczosSolverType lanczosSolver(matrix,params_);
+				try {
+					lanczosSolver.computeGroundState(energies_[p],vectors_[p]);
+				} catch (std::exception&) {
+					failed_[p] = 1;
+				}
+			}
+		}
+
+	private:
+
+		const InternalProductType& hamiltonian_;
+		SizeType productThreads_;
+		const ParametersForSolverType& params_;
+		const VectorSizeType& skip_;
+		VectorRealType& energies_;
+		VectorVectorType& vectors_;
+		VectorSizeType& failed_;
+	}; // class SectorGroundStateHelper
+
+	// Moments of the random vectors, vectors_ per sector, each with
+	// unthreaded products
+	class DensityOfStatesHelper {
+
+	public:
+
+		DensityOfStatesHelper(const InternalProductType& hamiltonian,
+		                      RealType emin,
+		                      RealType emax,
+		                      SizeType vectors,
+		                      SizeType totalMoments,
+		                      VectorVectorRealType& moments)
+		    : hamiltonian_(hamiltonian),
+		      emin_(emin),
+		      emax_(emax),
+		      vectors_(vectors),
+		      totalMoments_(totalMoments),
+		      moments_(moments)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			for (SizeType i=0;i<blockSize;i++) {
+				SizeType index = threadNum*blockSize + i;
+				if (index>=total) break;
+				SizeType p = index/vectors_;
+				SectorMatrix matrix(hamiltonian_,p,1);
+				if (matrix.rank() == 0) continue;
+				VectorType v;
+				randomVector(v,matrix.rank(),index);
+				KernelPolynomial<SectorMatrix,VectorType> kpm(matrix,emin_,emax_);
+				moments_[index].resize(totalMoments_,0.0);
+				kpm.moments(moments_[index],v);
+			}
+		}
+
+	private:
+
+		const InternalProductType& hamiltonian_;
+		RealType emin_;
+		RealType emax_;
+		SizeType vectors_;
+		SizeType totalMoments_;
+		VectorVectorRealType& moments_;
+	}; // class DensityOfStatesHelper
+
+	// A few Lanczos steps in each sector give its lowest Ritz value
+	// theta, an upper bound of the sector's energy, and
+	// theta - beta_m |s_m|, the Kato bound below the eigenvalue that
+	// theta approximates
+	class SectorProbeHelper {
+
+	public:
+
+		SectorProbeHelper(const InternalProductType& hamiltonian,
+		                  SizeType productThreads,
+		                  VectorRealType& ritz,
+		                  VectorRealType& lower)
+		    : hamiltonian_(hamiltonian),
+		      productThreads_(productThreads),
+		      ritz_(ritz),
+		      lower_(lower)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			for (SizeType i=0;i<blockSize;i++) {
+				SizeType p = threadNum*blockSize + i;
+				if (p>=total) break;
+				SectorMatrix matrix(hamiltonian_,p,productThreads_);
+				if (matrix.rank() == 0) continue;
+				probe(matrix,p);
+			}
+		}
+
+	private:
+
+		void probe(const SectorMatrix& matrix,SizeType p)
+		{
+			SizeType n = matrix.rank();
+			SizeType steps = (n < EARLY_STOP_STEPS) ? n : EARLY_STOP_STEPS;
+			VectorType v(n,0.0);
+			VectorType vOld(n,0.0);
+			VectorType w(n,0.0);
+			RandomType rng(1234 + p);
+			for (SizeType i=0;i<n;i++) v[i] = rng() - 0.5;
+			scale(v,1.0/norm2(v));
+
+			VectorRealType alpha;
+			VectorRealType beta;
+			RealType b = 0.0;
+			for (SizeType j=0;j<steps;j++) {
+				for (SizeType i=0;i<n;i++) w[i] = 0.0;
+				matrix.matrixVectorProduct(w,v);
+				RealType a = 0.0;
+				for (SizeType i=0;i<n;i++)
+					a += PsimagLite::real(PsimagLite::conj(v[i])*w[i]);
+				for (SizeType i=0;i<n;i++)
+					w[i] -= a*v[i] + b*vOld[i];
+				alpha.push_back(a);
+				b = norm2(w);
+				if (b < 1e-12 || j + 1 == steps) break;
+				beta.push_back(b);
+				vOld.swap(v);
+				v.swap(w);
+				scale(v,1.0/b);
+			}
+
+			SizeType m = alpha.size();
+			MatrixRealType t(m,m);
+			for (SizeType j=0;j<m;j++) {
+				t(j,j) = alpha[j];
+				if (j + 1 == m) continue;
+				t(j,j+1) = t(j+1,j) = beta[j];
+			}
+
+			VectorRealType eigs(m);
+			diag(t,eigs,'V');
+			ritz_[p] = eigs[0];
+			lower_[p] = eigs[0] - b*fabs(t(m-1,0));
+		}
+
+		static RealType norm2(const VectorType& v)
+		{
+			RealType sum = 0.0;
+			for (SizeType i=0;i<v.size();i++)
+				sum += PsimagLite::norm(v[i]);
+			return sqrt(sum);
+		}
+
+		static void scale(VectorType& v,RealType factor)
+		{
+			for (SizeType i=0;i<v.size();i++)
+				v[i] *= factor;
+		}
+
+		const InternalProductType& hamiltonian_;
+		SizeType productThreads_;
+		VectorRealType& ritz_;
+		VectorRealType& lower_;
+	}; // class SectorProbeHelper
+
 	void accModifiedState_(VectorType &z,
 	                       SizeType operatorLabel,
 	                       const BasisType& newBasis,
@@ -260,7 +807,7 @@ private:
 	                       SizeType site,
 	                       SizeType spin,
 	                       SizeType orb,
-	                       RealType isign) const
+	                       ComplexOrRealType factor) const
 	{
 		for (SizeType ispace=0;ispace<model_.basis().size();ispace++) {
 			ProgramGlobals::WordType ket1 = model_.basis()(ispace,SPIN_UP);
@@ -292,10 +839,17 @@ private:
 			        operatorLabel == ProgramGlobals::OPERATOR_SMINUS)
 				mysign *= model_.basis().doSignSpSm(ket1,ket2,site,spin,orb);
 
-			z[temp] += isign*mysign*value*gsVector[ispace];
+			z[temp] += factor*RealType(mysign*value)*gsComponent(gsVector,ispace);
 		}
 	}
 
+	// Component ispace of the ground state in the real-space basis
+	ComplexOrRealType gsComponent(const VectorType& gsVector,SizeType ispace) const
+	{
+		if (!gsSymmetry_) return gsVector[ispace];
+		return gsSymmetry_->realSpaceComponent(gsVector,gsSector_,ispace);
+	}
+
 	void getModifiedState(VectorType& modifVector,
 	                      SizeType operatorLabel,
 	                      const VectorType& gsVector,
@@ -342,80 +896,530 @@ private:
 	                      SizeType site,
 	                      SizeType spin,
 	                      SizeType orb,
-	                      RealType isign) const
+	                      ComplexOrRealType factor) const
 	{
 		if (model_.name()=="Tj1Orb.h")
-			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,isign);
+			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,factor);
 
 		if (operatorLabel==OPERATOR_N) {
-			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,isign);
+			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,factor);
 			return;
 		} else if (operatorLabel==ProgramGlobals::OPERATOR_SZ) {
-			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_UP,orb,isign*0.5);
-			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_DOWN,orb,-isign*0.5);
+			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_UP,orb,factor*0.5);
+			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_DOWN,orb,-factor*0.5);
 			return;
 		}
 
-		accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,isign);
+		accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,factor);
 	}
 
+	// Sectors are independent: with at least as many sectors as
+	// threads they run concurrently, each with unthreaded products;
+	// otherwise one after the other, with threaded products
 	void computeGroundState()
 	{
 		SpecialSymmetryType rs(model_.basis(),model_.geometry(),options_);
 		InternalProductType hamiltonian(model_,rs);
 		ParametersForSolverType params(io_,"Lanczos");
-		LanczosSolverType lanczosSolver(hamiltonian,params);
+
+		SizeType sectors = rs.sectors();
+		SizeType nthreads = ConcurrencyType::npthreads;
+		SizeType sectorThreads = (sectors >= nthreads) ? nthreads : 1;
+		SizeType productThreads = (sectorThreads > 1) ? 1 : nthreads;
+
+		VectorSizeType skip(sectors,0);
+		VectorRealType energies(sectors,1e10);
+		VectorVectorType vectors(sectors);
+		VectorSizeType failed(sectors,0);
+
+		if (options_.find("SectorEarlyStop") != PsimagLite::String::npos)
+			skipSectors(skip,hamiltonian,sectorThreads,productThreads);
+
+		typedef PsimagLite::Parallelizer<SectorGroundStateHelper> ParallelizerType;
+		SectorGroundStateHelper helper(hamiltonian,
+		                               productThreads,
+		                               params,
+		                               skip,
+		                               energies,
+		                               vectors,
+		                               failed);
+		ParallelizerType threadObject(sectorThreads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(sectors,helper);
+
+		for (SizeType i=0;i<sectors;i++) {
+			if (!failed[i]) continue;
+
+			std::cerr<<"Engine: Lanczos Solver failed ";
+			std::cerr<<" trying exact diagonalization...\n";
+			hamiltonian.specialSymmetrySector(i);
+			VectorRealType eigs(hamiltonian.rank());
+			MatrixType fm;
+			hamiltonian.fullDiag(eigs,fm);
+			for (SizeType j = 0; j < eigs.size(); ++j)
+				vectors[i][j] = fm(j,0);
+			energies[i] = eigs[0];
+			std::cout<<"Found lowest eigenvalue= "<<energies[i]<<"\n";
+		}
 
 		gsEnergy_ = 1e10;
 		SizeType offset = model_.size();
 		SizeType currentOffset = 0;
-		for (SizeType i=0;i<rs.sectors();i++) {
-			hamiltonian.specialSymmetrySector(i);
-			VectorType gsVector1(hamiltonian.rank());
-			if (gsVector1.size()==0) continue;
-			RealType gsEnergy1 = 0;
-
-			try {
-				lanczosSolver.computeGroundState(gsEnergy1,gsVector1);
-			} catch (std::exception& e) {
-
-				std::cerr<<"Engine: Lanczos Solver failed ";
-				std::cerr<<" trying exact diagonalization...\n";
-				VectorRealType eigs(hamiltonian.rank());
-				MatrixType fm;
-				hamiltonian.fullDiag(eigs,fm);
-				for (SizeType j = 0; j < eigs.size(); ++j)
-					gsVector1[j] = fm(j,0);
-				gsEnergy1 = eigs[0];
-				std::cout<<"Found lowest eigenvalue= "<<gsEnergy1<<"\n";
-			}
-
-			if (gsEnergy1<gsEnergy_) {
-				gsVector_=gsVector1;
-				gsEnergy_=gsEnergy1;
+		SizeType best = sectors;
+		for (SizeType i=0;i<sectors;i++) {
+			SizeType rank = hamiltonian.rank(i);
+			if (rank > 0 && !skip[i] && energies[i]<gsEnergy_) {
+				gsEnergy_=energies[i];
 				offset = currentOffset;
+				best = i;
 			}
-			currentOffset +=  gsVector1.size();
+
+			currentOffset += rank;
+		}
+
+		if (best < sectors) gsVector_.swap(vectors[best]);
+
+		// GsInSector: observables read the real-space components from
+		// the tables of a symmetry without stored matrices
+		if (best < sectors && options_.find("GsInSector") != PsimagLite::String::npos) {
+			gsSymmetry_ = newSymmetry(model_.basis());
+			gsSector_ = best;
 		}
-		rs.transformGs(gsVector_,offset);
+
+		if (!gsSymmetry_) rs.transformGs(gsVector_,offset);
 		std::cout<<"#GSNorm="<<PsimagLite::real(gsVector_*gsVector_)<<"\n";
 	}
 
-	template<typename ContinuedFractionType>
+	// SectorEarlyStop: a sector is skipped if the bound below its
+	// probed eigenvalue is above the lowest Ritz value of all sectors.
+	// The bound is for the eigenvalue that the Ritz value approximates,
+	// which after a few steps is the lowest one in practice
+	void skipSectors(VectorSizeType& skip,
+	                 const InternalProductType& hamiltonian,
+	                 SizeType sectorThreads,
+	                 SizeType productThreads)
+	{
+		SizeType sectors = skip.size();
+		VectorRealType ritz(sectors,1e10);
+		VectorRealType lower(sectors,1e10);
+
+		typedef PsimagLite::Parallelizer<SectorProbeHelper> ParallelizerType;
+		SectorProbeHelper helper(hamiltonian,productThreads,ritz,lower);
+		ParallelizerType threadObject(sectorThreads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(sectors,helper);
+
+		RealType best = 1e10;
+		for (SizeType i=0;i<sectors;i++)
+			if (ritz[i] < best) best = ritz[i];
+
+		SizeType skipped = 0;
+		for (SizeType i=0;i<sectors;i++) {
+			if (hamiltonian.rank(i) == 0 || lower[i] <= best) continue;
+			skip[i] = 1;
+			skipped++;
+		}
+
+		PsimagLite::OstringStream msg;
+		msg<<"SectorEarlyStop: "<<skipped<<" of "<<sectors<<" sectors skipped";
+		progress_.printline(msg,std::cout);
+	}
+
+	// The sector reached by type of G(isite,jsite), with the modified
+	// vector there, or 0 if the operator leads out of the model
+	const CachedSector* modifiedSector(VectorType& modifVector,
+	                                   SizeType& operatorLabel,
+	                                   SizeType what2,
+	                                   SizeType type,
+	                                   int isite,
+	                                   int jsite,
+	                                   SizeType spin,
+	                                   const PairType& orbs) const
+	{
+		operatorLabel= (type&1) ?  what2 : ProgramGlobals::transposeConjugate(what2);
+		bool newBasis = ProgramGlobals::needsNewBasis(operatorLabel);
+		PairType newParts(0,0);
+		if (newBasis && !model_.hasNewParts(newParts,operatorLabel,spin,orbs))
+			return 0;
+
+		const CachedSector& sector = cachedSector(newParts,newBasis);
+		getModifiedState(modifVector,
+		                 operatorLabel,
+		                 gsVector_,
+		                 *sector.basis,
+		                 type,
+		                 isite,
+		                 jsite,
+		                 spin,
+		                 orbs);
+
+		if (PsimagLite::norm(modifVector)<1e-10) {
+			std::cerr<<"spectralFunction: modifVector==0, type="<<type<<"\n";
+		}
+
+		return &sector;
+	}
+
+	// KpmMoments=, KpmKernel= and KpmLambda=, all optional
+	void kpmOptions(SizeType& moments,
+	                PsimagLite::String& kernel,
+	                RealType& lambda) const
+	{
+		moments = 256;
+		try {
+			io_.readline(moments,"KpmMoments=");
+		} catch (std::exception&) {}
+
+		kernel = "Jackson";
+		try {
+			io_.readline(kernel,"KpmKernel=");
+		} catch (std::exception&) {}
+
+		lambda = 4.0;
+		try {
+			io_.readline(lambda,"KpmLambda=");
+		} catch (std::exception&) {}
+	}
+
+	// Entries of phases +-1, a different sequence for each seed
+	static void randomVector(VectorType& v,SizeType n,SizeType seed)
+	{
+		RandomType rng(4321 + seed);
+		v.resize(n);
+		for (SizeType i=0;i<n;i++)
+			v[i] = (rng() < 0.5) ? -1.0 : 1.0;
+	}
+
+	// The damped moments, then A(omega) at the Chebyshev nodes, with
+	// omega = sign*(E - e0)
+	template<typename SomeKernelPolynomialType>
+	void printKpm(std::ostream& os,
+	              const SomeKernelPolynomialType& kpm,
+	              const VectorRealType& mu,
+	              RealType sign,
+	              RealType e0,
+	              RealType weight) const
+	{
+		for (SizeType n=0;n<mu.size();n++)
+			os<<mu[n]<<"\n";
+
+		os<<"#Spectrum\n";
+		VectorRealType energies;
+		kpm.nodes(energies,2*mu.size());
+		for (SizeType j=0;j<energies.size();j++) {
+			SizeType jj = (sign > 0) ? j : energies.size() - 1 - j;
+			os<<sign*(energies[jj] - e0)<<" ";
+			os<<weight*kpm.spectrum(mu,energies[jj])<<"\n";
+		}
+	}
+
+	// The sector of the excited states with electrons parts, or the sector
+	// of the ground state if !newBasis, built on first use
+	const CachedSector& cachedSector(const PairType& parts,bool newBasis) const
+	{
+		cacheClock_++;
+		typename ListCachedSectorType::iterator it = cache_.begin();
+		for (;it!=cache_.end();++it) {
+			CachedSector& sector = *it;
+			if (sector.newBasis != newBasis) continue;
+			if (newBasis && sector.parts != parts) continue;
+			sector.lastUse = cacheClock_;
+			return sector;
+		}
+
+		CachedSector sector;
+		sector.parts = parts;
+		sector.newBasis = newBasis;
+		sector.basis = (newBasis) ? model_.createBasis(parts.first,parts.second)
+		                          : &model_.basis();
+		sector.symm = newSymmetry(*sector.basis);
+		sector.matrix = 0;
+		sector.symmDefault = 0;
+		sector.matrixDefault = 0;
+		size_t nonZeros = 0;
+		if (sector.symm) {
+			sector.matrix = new InternalProductType(model_,*sector.basis,*sector.symm);
+			nonZeros = sector.matrix->nonZeros();
+		} else {
+			sector.symmDefault = new DefaultSymmetryType(*sector.basis,model_.geometry(),"");
+			sector.matrixDefault = new InternalProductDefaultType(model_,
+			                                                      *sector.basis,
+			                                                      *sector.symmDefault);
+			nonZeros = sector.matrixDefault->nonZeros();
+		}
+
+		sector.bytes = nonZeros*(sizeof(ComplexOrRealType) + sizeof(SizeType)) +
+		        static_cast<size_t>(sector.basis->size())*sizeof(RealType);
+		sector.lastUse = cacheClock_;
+
+		while (cache_.size() > 0 && cacheBytes_ + sector.bytes > cacheBudget_)
+			evictSector();
+
+		cacheBytes_ += sector.bytes;
+		cache_.push_back(sector);
+		return cache_.back();
+	}
+
+	// Frees the least recently used sector
+	void evictSector() const
+	{
+		typename ListCachedSectorType::iterator lru = cache_.begin();
+		typename ListCachedSectorType::iterator it = cache_.begin();
+		for (;it!=cache_.end();++it)
+			if (it->lastUse < lru->lastUse) lru = it;
+
+		PsimagLite::OstringStream msg;
+		msg<<"Evicting sector with "<<lru->basis->size()<<" states, ";
+		msg<<lru->bytes<<" bytes";
+		progress_.printline(msg,std::cout);
+
+		cacheBytes_ -= lru->bytes;
+		deleteSector(*lru);
+		cache_.erase(lru);
+	}
+
+	void deleteSector(CachedSector& sector) const
+	{
+		delete sector.matrix;
+		delete sector.symm;
+		delete sector.matrixDefault;
+		delete sector.symmDefault;
+		if (sector.newBasis) model_.releaseBasis(sector.basis);
+	}
+
+	// The symmetry for basis, or 0 if it does not apply there
+	SpecialSymmetryType* newSymmetry(const BasisType& basis) const
+	{
+		try {
+			return new SpecialSymmetryType(basis,model_.geometry(),spectralOptions());
+		} catch (std::exception& e) {
+			std::cerr<<"Engine: "<<e.what();
+			std::cerr<<"Engine: no special symmetry for this basis\n";
+		}
+
+		return 0;
+	}
+
+	// Matrices of the excited states are not printed
+	PsimagLite::String spectralOptions() const
+	{
+		PsimagLite::String options = options_;
+		PsimagLite::String noPrint[] = {"printmatrix","dumpmatrix"};
+		for (SizeType i=0;i<2;i++) {
+			size_t pos = options.find(noPrint[i]);
+			if (pos != PsimagLite::String::npos) options.erase(pos,noPrint[i].length());
+		}
+
+		return options;
+	}
+
+	// H is block diagonal, so the fraction of modifVector is the sum of
+	// the fractions of its components in each sector
+	template<typename ContinuedFractionCollectionType,
+	         typename SymmetryType,
+	         typename SomeInternalProductType>
+	void spectralInSectors(ContinuedFractionCollectionType& cfCollection,
+	                       VectorStringType& vstr,
+	                       const PsimagLite::String& label,
+	                       const SymmetryType& symm,
+	                       SomeInternalProductType& matrix,
+	                       SizeType operatorLabel,
+	                       const VectorType& modifVector,
+	                       SizeType type,
+	                       SizeType spin,
+	                       bool isDiagonal) const
+	{
+		typedef typename ContinuedFractionCollectionType::ContinuedFractionType
+		        ContinuedFractionType;
+
+		SizeType sectors = symm.sectors();
+		VectorType sectorVector;
+		for (SizeType p=0;p<sectors;p++) {
+			matrix.specialSymmetrySector(p);
+			if (matrix.rank() == 0) continue;
+			symm.transformToSector(sectorVector,modifVector,p);
+			if (sectors > 1 && PsimagLite::norm(sectorVector)<1e-10) continue;
+
+			ContinuedFractionType cf(cfCollection.freqType());
+			calcSpectral(cf,operatorLabel,sectorVector,matrix,type,spin,isDiagonal);
+			vstr.push_back((sectors > 1) ? label + "," + ttos(p) : label);
+			cfCollection.push(cf);
+		}
+	}
+
+	// e^{ik r} takes one complex vector, or cos(kr) and sin(kr)
+	static SizeType phaseParts(const RealType&) { return 2; }
+
+	static SizeType phaseParts(const std::complex<RealType>&) { return 1; }
+
+	static void setPhase(RealType& phase,RealType arg,SizeType part)
+	{
+		phase = (part == 0) ? cos(arg) : sin(arg);
+	}
+
+	static void setPhase(std::complex<RealType>& phase,RealType arg,SizeType)
+	{
+		phase = std::complex<RealType>(cos(arg),sin(arg));
+	}
+
+	// As spectralInSectors, with moments instead of continued fractions
+	template<typename SymmetryType,typename SomeInternalProductType>
+	void kpmInSectors(std::ostream& os,
+	                  const PsimagLite::String& label,
+	                  const SymmetryType& symm,
+	                  SomeInternalProductType& matrix,
+	                  SizeType operatorLabel,
+	                  const VectorType& modifVector,
+	                  SizeType type,
+	                  bool isDiagonal) const
+	{
+		typedef KernelPolynomial<SomeInternalProductType,VectorType> SomeKernelPolynomialType;
+
+		SizeType totalMoments = 0;
+		PsimagLite::String kernel;
+		RealType lambda = 0;
+		kpmOptions(totalMoments,kernel,lambda);
+
+		SizeType sectors = symm.sectors();
+		VectorType sectorVector;
+		for (SizeType p=0;p<sectors;p++) {
+			matrix.specialSymmetrySector(p);
+			if (matrix.rank() == 0) continue;
+			symm.transformToSector(sectorVector,modifVector,p);
+			if (PsimagLite::norm(sectorVector)<1e-10) continue;
+
+			RealType emin = 0.0;
+			RealType emax = 0.0;
+			SomeKernelPolynomialType::bounds(emin,emax,matrix,sectorVector,KPM_BOUND_STEPS);
+			SomeKernelPolynomialType kpm(matrix,emin,emax);
+			VectorRealType mu(totalMoments,0.0);
+			kpm.moments(mu,sectorVector);
+			SomeKernelPolynomialType::damp(mu,kernel,lambda);
+
+			RealType sign = (type&1) ? -1.0 : 1.0;
+			RealType weight = spectralWeight(operatorLabel,type,isDiagonal);
+			os<<"#KernelPolynomial "<<((sectors > 1) ? label + "," + ttos(p) : label);
+			os<<" "<<sign<<" "<<weight<<" "<<kpm.scaleFactor()<<" "<<kpm.shift();
+			os<<" "<<totalMoments<<"\n";
+			printKpm(os,kpm,mu,sign,gsEnergy_,weight);
+		}
+	}
+
+	// The electrons of the sector that operatorLabel reaches from the
+	// ground state, on each seed; band Lanczos needs all seeds there
+	bool greenParts(PairType& parts,
+	                SizeType operatorLabel,
+	                SizeType spin,
+	                const typename PsimagLite::Vector<PairType>::Type& seedIndex) const
+	{
+		for (SizeType i=0;i<seedIndex.size();i++) {
+			SizeType orb = seedIndex[i].second;
+			PairType tmp(0,0);
+			bool hasParts = model_.hasNewParts(tmp,operatorLabel,spin,PairType(orb,orb));
+			if (i == 0) {
+				if (!hasParts) return false;
+				parts = tmp;
+				continue;
+			}
+
+			if (hasParts && tmp == parts) continue;
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "greenMatrix: the seeds of orbital " + ttos(orb);
+			str += " are not in the sector of orbital " + ttos(seedIndex[0].second) + "\n";
+			throw std::runtime_error(str.c_str());
+		}
+
+		return (seedIndex.size() > 0);
+	}
+
+	// As spectralInSectors, for all the seeds at once. The seeds in the
+	// full space are kept until the last sector, and count in the budget
+	template<typename SymmetryType,typename SomeInternalProductType>
+	void greenInSectors(std::ostream& os,
+	                    const SymmetryType& symm,
+	                    SomeInternalProductType& matrix,
+	                    const VectorVectorType& seeds,
+	                    SizeType type,
+	                    SizeType maxKrylov,
+	                    size_t budget) const
+	{
+		typedef BandLanczos<SomeInternalProductType,VectorType> BandLanczosType;
+
+		SizeType sectors = symm.sectors();
+		SizeType nseeds = seeds.size();
+		size_t seedBytes = 0;
+		for (SizeType i=0;i<nseeds;i++)
+			seedBytes += seeds[i].size()*sizeof(ComplexOrRealType);
+
+		VectorVectorType sectorSeeds(nseeds);
+		for (SizeType p=0;p<sectors;p++) {
+			matrix.specialSymmetrySector(p);
+			SizeType rank = matrix.rank();
+			if (rank == 0) continue;
+			if (seedBytes + BandLanczosType::bytes(rank,nseeds,nseeds) > budget) {
+				PsimagLite::String str(__FILE__);
+				str += " " + ttos(__LINE__) + "\n";
+				str += "greenMatrix: the seeds and band Lanczos vectors do not fit in ";
+				str += "GreenMegabytes=" + ttos(budget/1048576) + "\n";
+				throw std::runtime_error(str.c_str());
+			}
+
+			SizeType wanted = (maxKrylov < rank) ? maxKrylov : rank;
+			SizeType krylov = wanted;
+			while (seedBytes + BandLanczosType::bytes(rank,nseeds,krylov) > budget)
+				krylov -= (krylov > 2*nseeds) ? nseeds : krylov - nseeds;
+
+			if (krylov < wanted) {
+				std::cerr<<"Engine: greenMatrix Krylov space of "<<krylov;
+				std::cerr<<" vectors instead of "<<wanted<<" to fit in GreenMegabytes=\n";
+			}
+
+			for (SizeType i=0;i<nseeds;i++)
+				symm.transformToSector(sectorSeeds[i],seeds[i],p);
+
+			BandLanczosType bandLanczos(matrix,krylov);
+			bandLanczos.decomposition(sectorSeeds);
+
+			const typename BandLanczosType::VectorRealType& poles = bandLanczos.poles();
+			const MatrixType& amplitudes = bandLanczos.amplitudes();
+			RealType s = (type&1) ? -1.0 : 1.0;
+			os<<"#GreenPart "<<type<<" "<<p<<" "<<poles.size()<<" "<<seeds.size()<<"\n";
+			for (SizeType k=0;k<poles.size();k++) {
+				os<<s*(poles[k] - gsEnergy_);
+				for (SizeType i=0;i<seeds.size();i++)
+					os<<" "<<amplitudes(k,i);
+				os<<"\n";
+			}
+		}
+	}
+
+	// Sign and factor of the part type in G(isite,jsite)
+	static RealType spectralWeight(SizeType what2,SizeType type,bool isDiagonal)
+	{
+		int s = (type&1) ? -1 : 1;
+		RealType s2 = (type>1) ? -1 : 1;
+		if (!ProgramGlobals::isFermionic(what2)) s2 *= s;
+		RealType diagonalFactor = (isDiagonal) ? 1 : 0.5;
+		return s2*diagonalFactor;
+	}
+
+	template<typename ContinuedFractionType,typename SomeInternalProductType>
 	void calcSpectral(ContinuedFractionType& cf,
 	                  SizeType what2,
 	                  const VectorType& modifVector,
-	                  const InternalProductDefaultType& matrix,
+	                  const SomeInternalProductType& matrix,
 	                  SizeType type,
 	                  SizeType,
 	                  bool isDiagonal) const
 	{
 		typedef typename ContinuedFractionType::TridiagonalMatrixType
 		        TridiagonalMatrixType;
+		typedef PsimagLite::LanczosSolver<ParametersForSolverType,
+		                                  SomeInternalProductType,
+		                                  VectorType> SomeLanczosSolverType;
 
 		ParametersForSolverType params(io_,"Spectral");
 
-		LanczosSolverDefaultType lanczosSolver(matrix,params);
+		SomeLanczosSolverType lanczosSolver(matrix,params);
 
 		TridiagonalMatrixType ab;
 
@@ -423,10 +1427,7 @@ private:
 		typename VectorType::value_type weight = modifVector*modifVector;
 
 		int s = (type&1) ? -1 : 1;
-		RealType s2 = (type>1) ? -1 : 1;
-		if (!ProgramGlobals::isFermionic(what2)) s2 *= s;
-		RealType diagonalFactor = (isDiagonal) ? 1 : 0.5;
-		s2 *= diagonalFactor;
+		RealType s2 = spectralWeight(what2,type,isDiagonal);
 
 		const MatrixRealType& reortho = lanczosSolver.reorthogonalizationMatrix();
 
@@ -440,6 +1441,13 @@ private:
 	PsimagLite::String options_;
 	RealType gsEnergy_;
 	VectorType gsVector_;
+	SpecialSymmetryType* gsSymmetry_;
+	SizeType gsSector_;
+	mutable VectorType gsRealSpace_;
+	size_t cacheBudget_;
+	mutable size_t cacheBytes_;
+	mutable SizeType cacheClock_;
+	mutable ListCachedSectorType cache_;
 }; // class ContinuedFraction
 } // namespace Dmrg
 
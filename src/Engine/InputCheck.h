@@ -141,7 +141,24 @@ public:
 		\item[none] Use this as a placeholder. ``none'' does not disable other options.
 		\item[InternalProductStored] Stored the sparse matrix in memory before diagonalizing it.
 		\item[InternalProductOnTheFly] Compute the sparse matrix on-the-fly while
-		diagonalizing it.
+		diagonalizing it. Rows are split among Threads= threads.
+		\item[KroneckerProduct] HubbardOneOrbital only. Implies InternalProductOnTheFly,
+		and applies the hopping as $T_\uparrow\otimes 1 + 1\otimes T_\downarrow$
+		using tables of size $C(N,n_\sigma)$ for each spin, instead of
+		recomputing each matrix element.
+		\item[Translation0, Translation1] With UseSymmetryGroup=1, translation by
+		one site along direction 0 or 1 of the geometry.
+		\item[Reflection] With UseSymmetryGroup=1, the reflection of the geometry.
+		Only abelian groups are supported, so it cannot be combined with a
+		translation along a ring, with which it does not commute.
+		\item[SpinFlip] With UseSymmetryGroup=1, the exchange of up and down
+		electrons; needs nup equal to ndown.
+		\item[SectorEarlyStop] With a special symmetry, first run a few Lanczos
+		steps in each sector, and skip the sectors whose lowest Ritz value minus
+		its residual is above the lowest Ritz value of all sectors.
+		\item[GsInSector] With a special symmetry, keep the ground state in the
+		basis of its sector; observables compute each real-space component
+		from the tables of the symmetry when needed.
 		\item[printmatrix] Print the Hamiltonian matrix.
 		\item[dumpmatrix] Use exact diagonalization instead of Lanczos diagonalization,
 		and output all information to obtain the full spectrum.
@@ -150,6 +167,13 @@ public:
 		registerOpts.push_back("none");
 		registerOpts.push_back("InternalProductStored");
 		registerOpts.push_back("InternalProductOnTheFly");
+		registerOpts.push_back("KroneckerProduct");
+		registerOpts.push_back("Translation0");
+		registerOpts.push_back("Translation1");
+		registerOpts.push_back("Reflection");
+		registerOpts.push_back("SpinFlip");
+		registerOpts.push_back("SectorEarlyStop");
+		registerOpts.push_back("GsInSector");
 		registerOpts.push_back("printmatrix");
 		registerOpts.push_back("dumpmatrix");
 
@@ -180,7 +204,7 @@ public:
 
 	void usage(const char *progName)
 	{
-		std::cerr<<"Usage: "<<progName<<" [-g -c] -f filename\n";
+		std::cerr<<"Usage: "<<progName<<" [-g -k -K -G -c -D] -f filename\n";
 	}
 
 private:
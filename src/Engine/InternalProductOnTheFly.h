@@ -84,6 +84,7 @@ DISCLOSED WOULD NOT INFRINGE PRIVATELY OWNED RIGHTS.
 
 #include <vector>
 #include <cassert>
+#include "Concurrency.h"
 
 namespace LanczosPlusPlus {
 template<typename ModelType,typename SpecialSymmetryType_>
@@ -99,37 +100,57 @@ public:
 	typedef typename GeometryType::ComplexOrRealType ComplexOrRealType;
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
 
 	InternalProductOnTheFly(const ModelType& model,
 	                        const BasisType& basis,
-	                        SpecialSymmetryType&)
-	    : model_(model),basis_(&basis)
+	                        SpecialSymmetryType& rs)
+	    : model_(model),basis_(basis),rs_(rs)
 	{
-		//model.setupHamiltonian(matrixStored_,b1,b2);
+		rs_.initOnTheFly(model,basis);
 	}
 
 	InternalProductOnTheFly(const ModelType& model,
-	                        SpecialSymmetryType&)
-	    : model_(model),basis_(0)
+	                        SpecialSymmetryType& rs)
+	    : model_(model),basis_(model.basis()),rs_(rs)
 	{
-		//model.setupHamiltonian(matrixStored_);
+		rs_.initOnTheFly(model,basis_);
 	}
 
-	SizeType rank() const { return model_.size(); }
+	// Size of the current sector of the special symmetry
+	SizeType rank() const { return rs_.rank(model_,basis_); }
 
 	template<typename SomeVectorType>
 	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y) const
 	{
-		if (basis_==0) {
-			model_.matrixVectorProduct(x,y);
-		} else {
-			model_.matrixVectorProduct(x,y,*basis_);
-		}
+		rs_.matrixVectorProduct(x,y,model_,basis_);
+	}
+
+	// Sector p of the special symmetry, whatever the current one is
+	SizeType rank(SizeType p) const { return rs_.rank(model_,basis_,p); }
+
+	SizeType nonZeros() const { return rs_.nonZeros(); }
+
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y,SizeType p) const
+	{
+		rs_.matrixVectorProduct(x,y,model_,basis_,p,ConcurrencyType::npthreads);
+	}
+
+	// With threads threads; 1 when the sectors themselves run in parallel
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         SizeType p,
+	                         SizeType threads) const
+	{
+		rs_.matrixVectorProduct(x,y,model_,basis_,p,threads);
 	}
 
 	SizeType reflectionSector() const { return 0; }
 
-	void specialSymmetrySector(SizeType p) {  }
+	void specialSymmetrySector(SizeType p) { rs_.setPointer(p); }
+
 	void fullDiag(VectorRealType&,
 	              MatrixType&)
 	{
@@ -139,7 +160,8 @@ public:
 private:
 
 	const ModelType& model_;
-	const BasisType* basis_;
+	const BasisType& basis_;
+	SpecialSymmetryType& rs_;
 }; // class InternalProductOnTheFly
 } // namespace LanczosPlusPlus
 
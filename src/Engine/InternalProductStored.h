@@ -115,12 +115,33 @@ public:
 
 	SizeType rank() const { return rs_.rank(); }
 
+	// Sector p of the special symmetry, whatever the current one is
+	SizeType rank(SizeType p) const { return rs_.rank(p); }
+
+	SizeType nonZeros() const { return rs_.nonZeros(); }
+
 	template<typename SomeVectorType>
 	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
 	{
 		rs_.matrixVectorProduct(x,y);
 	}
 
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y,SizeType p) const
+	{
+		rs_.matrixVectorProduct(x,y,p);
+	}
+
+	// The stored products are not threaded
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         SizeType p,
+	                         SizeType) const
+	{
+		rs_.matrixVectorProduct(x,y,p);
+	}
+
 	void specialSymmetrySector(SizeType p) { rs_.setPointer(p); }
 
 	void fullDiag(VectorRealType& eigs,
@@ -0,0 +1,212 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file KernelPolynomial.h
+ *
+ *  Kernel polynomial method: the spectral function of a vector v,
+ *  A(w) = <v|delta(w-H)|v>, from the Chebyshev moments
+ *  mu_n = <v|T_n(H~)|v> of H~ = (H-shift)/scale, which has its spectrum
+ *  in (-1,1). Each product by H gives two moments, and only two
+ *  vectors besides v are kept, so memory does not grow with the number
+ *  of moments. The moments are damped by the Jackson or the Lorentz
+ *  kernel, which fixes the resolution to about scale*pi/moments.
+ */
+#ifndef KERNEL_POLYNOMIAL_H
+#define KERNEL_POLYNOMIAL_H
+#include "Vector.h"
+#include "Matrix.h"
+
+namespace LanczosPlusPlus {
+
+template<typename SomeMatrixType,typename VectorType>
+class KernelPolynomial {
+
+	typedef typename VectorType::value_type ComplexOrRealType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+
+public:
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	// H~ maps [emin,emax] into [-0.99,0.99], with a margin for roundoff
+	KernelPolynomial(const SomeMatrixType& matrix,RealType emin,RealType emax)
+	    : matrix_(matrix),
+	      scale_(0.5*(emax - emin)/0.99),
+	      shift_(0.5*(emax + emin))
+	{
+		if (scale_ < 1e-10) scale_ = 1.0;
+	}
+
+	// Extremes of the Ritz values of a few Lanczos steps from v, widened
+	// by the last beta, which contain the spectrum seen by v
+	static void bounds(RealType& emin,
+	                   RealType& emax,
+	                   const SomeMatrixType& matrix,
+	                   const VectorType& v,
+	                   SizeType steps)
+	{
+		SizeType n = matrix.rank();
+		if (steps > n) steps = n;
+		VectorType w = v;
+		scale(w,1.0/norm2(w));
+		VectorType wOld(n,0.0);
+		VectorType z(n,0.0);
+		VectorRealType alpha;
+		VectorRealType beta;
+		RealType b = 0.0;
+		for (SizeType j=0;j<steps;j++) {
+			for (SizeType i=0;i<n;i++) z[i] = 0.0;
+			matrix.matrixVectorProduct(z,w);
+			RealType a = dot(w,z);
+			for (SizeType i=0;i<n;i++)
+				z[i] -= a*w[i] + b*wOld[i];
+			alpha.push_back(a);
+			b = norm2(z);
+			if (b < 1e-12 || j + 1 == steps) break;
+			beta.push_back(b);
+			wOld.swap(w);
+			w.swap(z);
+			scale(w,1.0/b);
+		}
+
+		SizeType m = alpha.size();
+		MatrixRealType t(m,m);
+		for (SizeType j=0;j<m;j++) {
+			t(j,j) = alpha[j];
+			if (j + 1 == m) continue;
+			t(j,j+1) = t(j+1,j) = beta[j];
+		}
+
+		VectorRealType eigs(m);
+		diag(t,eigs,'N');
+		emin = eigs[0] - b;
+		emax = eigs[m-1] + b;
+	}
+
+	// mu[n] = <v|T_n(H~)|v> for n < mu.size(), with
+	// mu_{2m} = 2<a_m|a_m> - mu_0 and mu_{2m+1} = 2<a_{m+1}|a_m> - mu_1,
+	// where a_m = T_m(H~)v
+	void moments(VectorRealType& mu,const VectorType& v) const
+	{
+		SizeType n = v.size();
+		SizeType total = mu.size();
+		if (total == 0) return;
+		VectorType alphaOld = v;
+		VectorType alpha(n,0.0);
+		matrix_.matrixVectorProduct(alpha,v);
+		for (SizeType i=0;i<n;i++)
+			alpha[i] = (alpha[i] - shift_*v[i])/scale_;
+
+		mu[0] = dot(v,v);
+		if (total == 1) return;
+		mu[1] = dot(alpha,v);
+
+		for (SizeType m=1;2*m<total;m++) {
+			mu[2*m] = 2.0*dot(alpha,alpha) - mu[0];
+			if (2*m + 1 == total) break;
+
+			// alphaOld becomes 2H~alpha - alphaOld
+			for (SizeType i=0;i<n;i++)
+				alphaOld[i] = -0.5*scale_*alphaOld[i] - shift_*alpha[i];
+			matrix_.matrixVectorProduct(alphaOld,alpha);
+			scale(alphaOld,2.0/scale_);
+
+			mu[2*m + 1] = 2.0*dot(alphaOld,alpha) - mu[1];
+			alpha.swap(alphaOld);
+		}
+	}
+
+	// kernel is Jackson, or Lorentz with parameter lambda
+	static void damp(VectorRealType& mu,const PsimagLite::String& kernel,RealType lambda)
+	{
+		if (kernel != "Jackson" && kernel != "Lorentz")
+			throw PsimagLite::RuntimeError("KernelPolynomial: unknown kernel " + kernel + "\n");
+
+		bool jackson = (kernel == "Jackson");
+		SizeType total = mu.size();
+		RealType phi = M_PI/RealType(total + 1);
+		for (SizeType n=0;n<total;n++) {
+			RealType g = (jackson) ?
+			            ((total - n + 1)*cos(phi*n) + sin(phi*n)*cos(phi)/sin(phi))/(total + 1) :
+			            sinh(lambda*(1.0 - RealType(n)/total))/sinh(lambda);
+			mu[n] *= g;
+		}
+	}
+
+	// A(omega) from the damped moments
+	RealType spectrum(const VectorRealType& mu,RealType omega) const
+	{
+		RealType x = (omega - shift_)/scale_;
+		if (mu.size() == 0 || fabs(x) >= 1.0) return 0.0;
+
+		RealType sum = mu[0];
+		RealType tOld = 1.0;
+		RealType t = x;
+		for (SizeType n=1;n<mu.size();n++) {
+			sum += 2.0*mu[n]*t;
+			RealType tNew = 2.0*x*t - tOld;
+			tOld = t;
+			t = tNew;
+		}
+
+		return sum/(M_PI*scale_*sqrt(1.0 - x*x));
+	}
+
+	// The Chebyshev nodes x_j = cos(pi(j+1/2)/total), in ascending order,
+	// as energies
+	void nodes(VectorRealType& omegas,SizeType total) const
+	{
+		omegas.resize(total);
+		for (SizeType j=0;j<total;j++)
+			omegas[total - 1 - j] = shift_ + scale_*cos(M_PI*(j + 0.5)/total);
+	}
+
+	RealType scaleFactor() const { return scale_; }
+
+	RealType shift() const { return shift_; }
+
+private:
+
+	static RealType dot(const VectorType& v,const VectorType& w)
+	{
+		RealType sum = 0.0;
+		for (SizeType i=0;i<v.size();i++)
+			sum += PsimagLite::real(PsimagLite::conj(v[i])*w[i]);
+		return sum;
+	}
+
+	static RealType norm2(const VectorType& v)
+	{
+		return sqrt(dot(v,v));
+	}
+
+	static void scale(VectorType& v,RealType factor)
+	{
+		for (SizeType i=0;i<v.size();i++)
+			v[i] *= factor;
+	}
+
+	const SomeMatrixType& matrix_;
+	RealType scale_;
+	RealType shift_;
+}; // class KernelPolynomial
+} // namespace LanczosPlusPlus
+
+#endif  // KERNEL_POLYNOMIAL_H
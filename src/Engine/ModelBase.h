@@ -22,6 +22,7 @@ Please see full open source license included in file LICENSE.
 #define LANCZOS_MODEL_BASE_H
 #include "CrsMatrix.h"
 #include "BasisBase.h"
+#include "BasisRegistry.h"
 #include "Vector.h"
 
 namespace LanczosPlusPlus {
@@ -40,6 +41,7 @@ public:
 	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
 	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
 	typedef typename PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
 
 	virtual ~ModelBase() {}
 
@@ -65,19 +67,52 @@ public:
 		        ("ModelBase::matrixVectorProduct(2) not impl. for this model\n");
 	}
 
+	// x += H y in basis, with threads threads
 	virtual void matrixVectorProduct(VectorType&,
 	                                 const VectorType&,
-	                                 const BasisBaseType&) const
+	                                 const BasisBaseType&,
+	                                 SizeType) const
 	{
 		throw PsimagLite::RuntimeError
-		        ("ModelBase::matrixVectorProduct(3) not impl. for this model\n");
+		        ("ModelBase::matrixVectorProduct(4) not impl. for this model\n");
+	}
+
+	// Row generator, used by symmetries that apply H one row at a time
+	virtual RealType diagonalElement(SizeType,const BasisBaseType&) const
+	{
+		throw PsimagLite::RuntimeError
+		        ("ModelBase::diagonalElement not impl. for this model\n");
+	}
+
+	// Pushes row ispace, with diag[ispace] on the diagonal, into matrix;
+	// returns the number of nonzeros pushed
+	virtual SizeType setupRow(SparseMatrixType&,
+	                          SizeType,
+	                          const VectorRealType&,
+	                          const BasisBaseType&) const
+	{
+		throw PsimagLite::RuntimeError
+		        ("ModelBase::setupRow not impl. for this model\n");
 	}
 
 	virtual const BasisBaseType& basis() const = 0;
 
 	virtual PsimagLite::String name() const  = 0;
 
-	virtual BasisBaseType* createBasis(SizeType nup, SizeType ndown) const = 0;
+	// The basis with nup and ndown electrons, shared by all its callers;
+	// each call must be matched by a releaseBasis
+	const BasisBaseType* createBasis(SizeType nup, SizeType ndown) const
+	{
+		std::pair<SizeType,SizeType> parts(nup,ndown);
+		const BasisBaseType* basis = bases_.acquire(parts);
+		if (basis) return basis;
+		return bases_.insert(parts,newBasis(nup,ndown));
+	}
+
+	void releaseBasis(const BasisBaseType* basis) const
+	{
+		bases_.release(basis);
+	}
 
 	virtual void print(std::ostream& os) const = 0;
 
@@ -91,16 +126,12 @@ public:
 
 protected:
 
-	template<typename SomeVectorType>
-	static typename PsimagLite::EnableIf<PsimagLite::IsVectorLike<SomeVectorType>::True,
-	void>::Type deleteGarbage(SomeVectorType& garbage)
-	{
-		for (SizeType i = 0; i < garbage.size(); ++i) {
-			delete garbage[i];
-			garbage[i] = 0;
-		}
-	}
+	// A new basis with nup and ndown electrons, for createBasis
+	virtual BasisBaseType* newBasis(SizeType nup, SizeType ndown) const = 0;
+
+private:
 
+	mutable BasisRegistry<BasisBaseType> bases_;
 }; // class ModelBase
 
 template<typename RealType,typename GeometryType,typename InputType>
@@ -0,0 +1,467 @@
+/*
+Copyright (c) 2009-2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+#ifndef PAIR_SYMM_H
+#define PAIR_SYMM_H
+#include <iostream>
+#include <algorithm>
+#include "ProgressIndicator.h"
+#include "CrsMatrix.h"
+#include "Vector.h"
+#include "SparseRow.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "DiagonalCache.h"
+#include "ParallelHamiltonianSetup.h"
+#include "SectorExpansion.h"
+
+namespace LanczosPlusPlus {
+
+// A state i with G|i> = sign|j>; i == j if the state is its own image
+struct PairSymmetryItem {
+
+	PairSymmetryItem(SizeType ii,SizeType jj,int s)
+	    : i(ii),j(jj),sign(s)
+	{}
+
+	SizeType i,j;
+	int sign;
+};
+
+/* Symmetry G with G^2 = 1, so that its sectors are made of pairs of
+   states. ImagePolicyType is built from (basis,geometry) and provides
+   SizeType image(SizeType state,int& sign) const
+   with G|state> = sign|image>, sign being multiplied, and the static
+   className() and name() of the symmetry.
+   Sector 0 is even under G, sector 1 is odd. */
+template<typename GeometryType_,typename BasisType,typename ImagePolicyType>
+class PairSymmetry  {
+
+	typedef typename GeometryType_::ComplexOrRealType ComplexOrRealType;
+	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef PairSymmetryItem ItemType;
+	typedef PsimagLite::Vector<ItemType>::Type VectorItemType;
+	typedef DiagonalCache<RealType,BasisType> DiagonalCacheType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	// x += H_p y in sector p, one row at a time
+	template<typename SomeModelType,typename SomeVectorType>
+	class SectorProductHelper {
+
+		typedef typename SomeModelType::SparseMatrixType ModelSparseMatrixType;
+		typedef typename PsimagLite::Vector<RealType>::Type VectorDiagType;
+		typedef PsimagLite::SparseRow<ModelSparseMatrixType> SparseRowType;
+
+	public:
+
+		SectorProductHelper(SomeVectorType& x,
+		                    const SomeVectorType& y,
+		                    const PairSymmetry& symm,
+		                    const SomeModelType& model,
+		                    const VectorDiagType& diag,
+		                    SizeType p)
+		    : x_(x),y_(y),symm_(symm),model_(model),diag_(diag),p_(p)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			ModelSparseMatrixType row;
+			SparseRowType sparseRow;
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType a = threadNum*blockSize + p;
+				if (a>=total) break;
+				symm_.setSectorRow(sparseRow,row,model_,p_,a,diag_);
+				x_[a] += sparseRow.finalize(y_);
+			}
+		}
+
+	private:
+
+		SomeVectorType& x_;
+		const SomeVectorType& y_;
+		const PairSymmetry& symm_;
+		const SomeModelType& model_;
+		const VectorDiagType& diag_;
+		SizeType p_;
+	}; // class SectorProductHelper
+
+public:
+
+	typedef GeometryType_ GeometryType;
+	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	// Each pair {|i>,|j>} with G|i> = sign|j> and i < j gives
+	// (|i> + sign|j>)/sqrt(2) to sector 0 and (|i> - sign|j>)/sqrt(2)
+	// to sector 1; a state with i == j goes to the sector of sign
+	PairSymmetry(const BasisType& basis,
+	             const GeometryType& geometry,
+	             PsimagLite::String options)
+	    : progress_(ImagePolicyType::className()),
+	      basis_(basis),
+	      policy_(basis,geometry),
+	      sectors_(2),
+	      matrixStored_(2),
+	      pointer_(0),
+	      printMatrix_(options.find("printmatrix")!=PsimagLite::String::npos)
+	{
+		SizeType hilbert = basis.size();
+		SizeType selfImages = 0;
+		for (SizeType ispace=0;ispace<hilbert;ispace++) {
+			int sign = 1;
+			SizeType yIndex = policy_.image(ispace,sign);
+			if (yIndex==ispace) {
+				sectors_[(sign > 0) ? 0 : 1].push_back(ItemType(ispace,ispace,sign));
+				selfImages++;
+				continue;
+			}
+
+			// the pair is kept once, from its smaller state
+			if (yIndex<ispace) continue;
+			sectors_[0].push_back(ItemType(ispace,yIndex,sign));
+			sectors_[1].push_back(ItemType(ispace,yIndex,sign));
+		}
+
+		PsimagLite::OstringStream msg;
+		msg<<"even="<<sectors_[0].size()<<" odd="<<sectors_[1].size();
+		msg<<" self images="<<selfImages;
+		progress_.printline(msg,std::cout);
+	}
+
+	// Fills both blocks row by row; the full Hamiltonian is never stored.
+	// Each row is also compared with the row of its partner state, as
+	// terms of the model that break G are not seen by the geometry
+	template<typename SomeModelType>
+	void init(const SomeModelType& model,const BasisType& basis)
+	{
+		checkBasis(basis);
+		typedef typename SomeModelType::SparseMatrixType ModelSparseMatrixType;
+		typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
+
+		const VectorRealType& diag = diagonalCache_(model,basis);
+		checkDiagonal(diag);
+		ModelSparseMatrixType row;
+		ModelSparseMatrixType partnerRow;
+		for (SizeType p=0;p<sectors_.size();p++) {
+			const VectorItemType& items = sectors_[p];
+			for (SizeType a=0;a<items.size();a++) {
+				// pairs are in both sectors; check them once
+				if (p == 1 && items[a].i != items[a].j) continue;
+				checkRow(row,partnerRow,model,items[a],diag);
+			}
+		}
+
+		SparseRowType sparseRow;
+		for (SizeType p=0;p<sectors_.size();p++) {
+			SizeType rank = sectors_[p].size();
+			SparseMatrixType& m = matrixStored_[p];
+			m.resize(rank,rank);
+			SizeType counter = 0;
+			for (SizeType a=0;a<rank;a++) {
+				m.setRow(a,counter);
+				setSectorRow(sparseRow,row,model,p,a,diag);
+				counter += sparseRow.finalize(m);
+			}
+
+			m.setRow(rank,counter);
+			m.checkValidity();
+		}
+
+		int nrows = matrixStored_[0].row();
+		if (printMatrix_) {
+			if (nrows > 40)
+				throw PsimagLite::RuntimeError("printMatrix too big\n");
+			std::cout<<matrixStored_[0].toDense();
+		}
+	}
+
+	SizeType rank() const { return rank(pointer_); }
+
+	SizeType rank(SizeType p) const { return matrixStored_[p].row(); }
+
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
+	{
+		matrixVectorProduct(x,y,pointer_);
+	}
+
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y,SizeType p) const
+	{
+		return matrixStored_[p].matrixVectorProduct(x,y);
+	}
+
+	// On the fly the rows of a sector are made when needed; the
+	// diagonal is computed here so that sectors can then be used
+	// from several threads. Only the diagonal is checked, since
+	// checking the rows would cost one full Hamiltonian build
+	template<typename SomeModelType>
+	void initOnTheFly(const SomeModelType& model,const BasisType& basis)
+	{
+		checkBasis(basis);
+		checkDiagonal(diagonalCache_(model,basis));
+	}
+
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType&,const BasisType&) const
+	{
+		return sectors_[pointer_].size();
+	}
+
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType&,const BasisType&,SizeType p) const
+	{
+		return sectors_[p].size();
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis) const
+	{
+		matrixVectorProduct(x,y,model,basis,pointer_,ConcurrencyType::npthreads);
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis,
+	                         SizeType p,
+	                         SizeType threads) const
+	{
+		SizeType rank = sectors_[p].size();
+		assert(x.size() == rank && y.size() == rank);
+		typedef SectorProductHelper<SomeModelType,SomeVectorType> HelperType;
+		typedef PsimagLite::Parallelizer<HelperType> ParallelizerType;
+		HelperType helper(x,y,*this,model,diagonalCache_(model,basis,threads),p);
+		ParallelizerType threadObject(threads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(rank,helper);
+	}
+
+	// gs is in the sector that starts at offset
+	void transformGs(VectorType& gs,SizeType offset)
+	{
+		SizeType p = (offset == 0 && sectors_[0].size() > 0) ? 0 : 1;
+		if (sectors_[p].size() != gs.size())
+			throw PsimagLite::RuntimeError(ImagePolicyType::className() + ": wrong offset\n");
+
+		VectorType gstmp;
+		SectorExpansion<PairSymmetry>::expand(gstmp,gs,*this,p,basis_.size());
+		gs.swap(gstmp);
+	}
+
+	// Component ispace of the real-space form of v, of sector p
+	ComplexOrRealType realSpaceComponent(const VectorType& v,
+	                                     SizeType p,
+	                                     SizeType ispace) const
+	{
+		int sign = 1;
+		SizeType yIndex = policy_.image(ispace,sign);
+		SizeType smaller = (yIndex < ispace) ? yIndex : ispace;
+		const VectorItemType& items = sectors_[p];
+		typename VectorItemType::const_iterator it = std::lower_bound(items.begin(),
+		                                                              items.end(),
+		                                                              smaller,
+		                                                              lessBySmallerState);
+		if (it == items.end() || it->i != smaller) return 0.0; // self image of other sector
+		SizeType a = it - items.begin();
+		if (it->i == it->j) return v[a];
+		RealType oneOverSqrt2 = 1.0/sqrt(2.0);
+		if (ispace == smaller) return oneOverSqrt2*v[a];
+		return (pairSign(p,*it)*oneOverSqrt2)*v[a];
+	}
+
+	// Components of the real-space vector src in sector p
+	void transformToSector(VectorType& dest,const VectorType& src,SizeType p) const
+	{
+		RealType oneOverSqrt2 = 1.0/sqrt(2.0);
+		const VectorItemType& items = sectors_[p];
+		dest.resize(items.size());
+		for (SizeType a=0;a<items.size();a++) {
+			if (items[a].i == items[a].j) {
+				dest[a] = src[items[a].i];
+				continue;
+			}
+
+			RealType partnerSign = pairSign(p,items[a])*oneOverSqrt2;
+			dest[a] = oneOverSqrt2*src[items[a].i] + partnerSign*src[items[a].j];
+		}
+	}
+
+	SizeType sectors() const { return 2; }
+
+	// Stored elements, for the memory estimate of the sector cache
+	SizeType nonZeros() const
+	{
+		SizeType sum = 0;
+		for (SizeType i=0;i<matrixStored_.size();i++)
+			sum += matrixStored_[i].nonZeros();
+		return sum;
+	}
+
+	void setPointer(SizeType p) { pointer_=p; }
+
+	PsimagLite::String name() const { return ImagePolicyType::name(); }
+
+	void fullDiag(VectorRealType& eigs,MatrixType& fm) const
+	{
+		if (matrixStored_[pointer_].row() > 1000)
+			throw PsimagLite::RuntimeError("fullDiag too big\n");
+
+		fm = matrixStored_[pointer_].toDense();
+		diag(fm,eigs,'V');
+
+		if (!printMatrix_) return;
+
+		for (SizeType i=0;i<eigs.size();i++)
+			std::cout<<eigs[i]<<"\n";
+		std::cout<<fm;
+	}
+
+private:
+
+	void checkBasis(const BasisType& basis) const
+	{
+		if (&basis != &basis_)
+			throw PsimagLite::RuntimeError(ImagePolicyType::className() + ": wrong basis\n");
+	}
+
+	void throwNoSymmetry(PsimagLite::String what) const
+	{
+		PsimagLite::String s(__FILE__);
+		s += " Hamiltonian has no " + ImagePolicyType::name() + " symmetry:" + what;
+		throw std::runtime_error(s.c_str());
+	}
+
+	// A potential or field that breaks G shows up here
+	void checkDiagonal(const VectorRealType& diag) const
+	{
+		for (SizeType p=0;p<sectors_.size();p++) {
+			const VectorItemType& items = sectors_[p];
+			for (SizeType a=0;a<items.size();a++) {
+				if (fabs(diag[items[a].i] - diag[items[a].j]) > 1e-10)
+					throwNoSymmetry(" diagonal differs.");
+			}
+		}
+	}
+
+	// H(i,c) == sign_i sign_c H(j,G(c)) for all c, from G H G = H
+	template<typename SomeModelType>
+	void checkRow(typename SomeModelType::SparseMatrixType& row,
+	              typename SomeModelType::SparseMatrixType& partnerRow,
+	              const SomeModelType& model,
+	              const ItemType& item,
+	              const VectorRealType& diag) const
+	{
+		typedef ParallelHamiltonianSetup<SomeModelType> SetupType;
+		SizeType n = SetupType::setupRow(row,model,item.i,diag,basis_);
+		SizeType m = SetupType::setupRow(partnerRow,model,item.j,diag,basis_);
+		if (nonZeros(row,n) != nonZeros(partnerRow,m))
+			throwNoSymmetry(" hoppings differ.");
+
+		for (SizeType t=0;t<n;t++) {
+			int sign = item.sign;
+			SizeType col = policy_.image(row.getCol(t),sign);
+			ComplexOrRealType val = 0.0;
+			for (SizeType u=0;u<m;u++) {
+				if (SizeType(partnerRow.getCol(u)) != col) continue;
+				val = partnerRow.getValue(u);
+				break;
+			}
+
+			if (PsimagLite::norm(row.getValue(t) - RealType(sign)*val) > 1e-12)
+				throwNoSymmetry(" hoppings differ.");
+		}
+	}
+
+	template<typename SomeSparseMatrixType>
+	static SizeType nonZeros(const SomeSparseMatrixType& row,SizeType n)
+	{
+		SizeType c = 0;
+		for (SizeType t=0;t<n;t++)
+			if (PsimagLite::norm(row.getValue(t)) > 1e-12) c++;
+		return c;
+	}
+
+	// Coefficient of |j> relative to |i> in the vectors of sector p
+	static RealType pairSign(SizeType p,const ItemType& item)
+	{
+		return (p == 0) ? item.sign : -item.sign;
+	}
+
+	static bool lessBySmallerState(const ItemType& item,SizeType state)
+	{
+		return (item.i < state);
+	}
+
+	// Row a of sector p, from the real-space row of its smaller state.
+	// G commutes with H, so <a|H|b> = f_a <i_a|H|b> with f_a = sqrt(2)
+	// for pairs and 1 otherwise; each column c of that row adds
+	// H(i_a,c) <c|b> to the column b of c
+	template<typename SomeModelType,typename SparseRowType>
+	void setSectorRow(SparseRowType& sparseRow,
+	                  typename SomeModelType::SparseMatrixType& row,
+	                  const SomeModelType& model,
+	                  SizeType p,
+	                  SizeType a,
+	                  const VectorRealType& diag) const
+	{
+		const VectorItemType& items = sectors_[p];
+		const ItemType& itemA = items[a];
+		SizeType n = ParallelHamiltonianSetup<SomeModelType>::setupRow(row,
+		                                                               model,
+		                                                               itemA.i,
+		                                                               diag,
+		                                                               basis_);
+		RealType oneOverSqrt2 = 1.0/sqrt(2.0);
+		RealType factorA = (itemA.i == itemA.j) ? 1.0 : sqrt(2.0);
+		for (SizeType t=0;t<n;t++) {
+			SizeType col = row.getCol(t);
+			int sign = 1;
+			SizeType yCol = policy_.image(col,sign);
+			SizeType smaller = (yCol < col) ? yCol : col;
+			typename VectorItemType::const_iterator it = std::lower_bound(items.begin(),
+			                                                              items.end(),
+			                                                              smaller,
+			                                                              lessBySmallerState);
+			if (it == items.end() || it->i != smaller) continue; // self image of other sector
+			RealType overlap = 1.0;
+			if (it->i != it->j)
+				overlap = (col == smaller) ? oneOverSqrt2 : pairSign(p,*it)*oneOverSqrt2;
+			sparseRow.add(it - items.begin(),row.getValue(t)*(factorA*overlap));
+		}
+	}
+
+	PsimagLite::ProgressIndicator progress_;
+	const BasisType& basis_;
+	ImagePolicyType policy_;
+	typename PsimagLite::Vector<VectorItemType>::Type sectors_;
+	typename PsimagLite::Vector<SparseMatrixType>::Type matrixStored_;
+	SizeType pointer_;
+	bool printMatrix_;
+	mutable DiagonalCacheType diagonalCache_;
+}; // class PairSymmetry
+} // namespace LanczosPlusPlus
+
+#endif  // PAIR_SYMM_H
@@ -0,0 +1,204 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file ParallelHamiltonianSetup.h
+ *
+ *  Fills the CRS Hamiltonian of a model using threads.
+ *
+ *  The model provides
+ *  SizeType setupRow(SparseMatrixType&,SizeType,const VectorRealType&,
+ *                    const BasisBaseType&) const
+ *  that pushes the row ispace (diagonal included) into the matrix and
+ *  returns the number of nonzeros pushed.
+ *
+ *  With more than one thread the matrix is built in two passes:
+ *  the first one counts nonzeros per row, the row pointers are then
+ *  prefix-summed, and the second one writes columns and values of each
+ *  row at its final offset. Rows are independent and are computed with
+ *  the same SparseRow code as the serial build, so the result is
+ *  identical to it.
+ */
+#ifndef PARALLEL_HAMILTONIAN_SETUP_H
+#define PARALLEL_HAMILTONIAN_SETUP_H
+#include "Vector.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ModelType>
+class ParallelHamiltonianSetup {
+
+	typedef typename ModelType::SparseMatrixType SparseMatrixType;
+	typedef typename ModelType::BasisBaseType BasisBaseType;
+	typedef typename ModelType::RealType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	class RowCounterHelper {
+
+	public:
+
+		RowCounterHelper(VectorSizeType& nonzeros,
+		                 const ModelType& model,
+		                 const VectorRealType& diag,
+		                 const BasisBaseType& basis)
+		    : nonzeros_(nonzeros),model_(model),diag_(diag),basis_(basis)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			SparseMatrixType row;
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType ispace = threadNum*blockSize + p;
+				if (ispace>=total) break;
+				nonzeros_[ispace] = setupRow(row,model_,ispace,diag_,basis_);
+			}
+		}
+
+	private:
+
+		VectorSizeType& nonzeros_;
+		const ModelType& model_;
+		const VectorRealType& diag_;
+		const BasisBaseType& basis_;
+	}; // class RowCounterHelper
+
+	class RowFillerHelper {
+
+	public:
+
+		RowFillerHelper(SparseMatrixType& matrix,
+		                const ModelType& model,
+		                const VectorRealType& diag,
+		                const BasisBaseType& basis)
+		    : matrix_(matrix),model_(model),diag_(diag),basis_(basis)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			SparseMatrixType row;
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType ispace = threadNum*blockSize + p;
+				if (ispace>=total) break;
+				SizeType n = setupRow(row,model_,ispace,diag_,basis_);
+				SizeType offset = matrix_.getRowPtr(ispace);
+				assert(offset + n == SizeType(matrix_.getRowPtr(ispace+1)));
+				for (SizeType k=0;k<n;k++) {
+					matrix_.setCol(offset+k,row.getCol(k));
+					matrix_.setValues(offset+k,row.getValue(k));
+				}
+			}
+		}
+
+	private:
+
+		SparseMatrixType& matrix_;
+		const ModelType& model_;
+		const VectorRealType& diag_;
+		const BasisBaseType& basis_;
+	}; // class RowFillerHelper
+
+public:
+
+	ParallelHamiltonianSetup(const ModelType& model,
+	                         const VectorRealType& diag,
+	                         const BasisBaseType& basis)
+	    : model_(model),diag_(diag),basis_(basis)
+	{}
+
+	// Row ispace alone, as a 1 x hilbert matrix; returns its nonzeros
+	static SizeType setupRow(SparseMatrixType& row,
+	                         const ModelType& model,
+	                         SizeType ispace,
+	                         const VectorRealType& diag,
+	                         const BasisBaseType& basis)
+	{
+		row.resize(1,basis.size());
+		row.setRow(0,0);
+		return model.setupRow(row,ispace,diag,basis);
+	}
+
+	void operator()(SparseMatrixType& matrix) const
+	{
+		SizeType hilbert = basis_.size();
+		if (ConcurrencyType::npthreads == 1 || hilbert < 2) {
+			serialSetup(matrix);
+			return;
+		}
+
+		typedef PsimagLite::Parallelizer<RowCounterHelper> ParallelizerCounterType;
+		typedef PsimagLite::Parallelizer<RowFillerHelper> ParallelizerFillerType;
+
+		VectorSizeType nonzeros(hilbert,0);
+		RowCounterHelper counter(nonzeros,model_,diag_,basis_);
+		ParallelizerCounterType threadCounter(ConcurrencyType::npthreads,
+		                                      PsimagLite::MPI::COMM_WORLD);
+		threadCounter.loopCreate(hilbert,counter);
+
+		SizeType nCounter = 0;
+		for (SizeType ispace=0;ispace<hilbert;ispace++)
+			nCounter += nonzeros[ispace];
+
+		matrix.resize(hilbert,hilbert,nCounter);
+		nCounter = 0;
+		for (SizeType ispace=0;ispace<hilbert;ispace++) {
+			matrix.setRow(ispace,nCounter);
+			nCounter += nonzeros[ispace];
+		}
+
+		matrix.setRow(hilbert,nCounter);
+
+		RowFillerHelper filler(matrix,model_,diag_,basis_);
+		ParallelizerFillerType threadFiller(ConcurrencyType::npthreads,
+		                                    PsimagLite::MPI::COMM_WORLD);
+		threadFiller.loopCreate(hilbert,filler);
+		matrix.checkValidity();
+	}
+
+private:
+
+	void serialSetup(SparseMatrixType& matrix) const
+	{
+		SizeType hilbert = basis_.size();
+		matrix.resize(hilbert,hilbert);
+		SizeType nCounter = 0;
+		for (SizeType ispace=0;ispace<hilbert;ispace++) {
+			matrix.setRow(ispace,nCounter);
+			nCounter += model_.setupRow(matrix,ispace,diag_,basis_);
+		}
+
+		matrix.setRow(hilbert,nCounter);
+		matrix.checkValidity();
+	}
+
+	const ModelType& model_;
+	const VectorRealType& diag_;
+	const BasisBaseType& basis_;
+}; // class ParallelHamiltonianSetup
+} // namespace LanczosPlusPlus
+#endif // PARALLEL_HAMILTONIAN_SETUP_H
+
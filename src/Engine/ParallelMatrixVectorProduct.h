@@ -0,0 +1,114 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file ParallelMatrixVectorProduct.h
+ *
+ *  On-the-fly x += H y using threads.
+ *
+ *  The model provides
+ *  ComplexOrRealType offDiagonalProduct(const VectorType&,SizeType,
+ *                                       const BasisBaseType&) const
+ *  that returns the product of the off-diagonal part of row ispace
+ *  with y. Rows are split in blocks among threads, and each thread
+ *  only writes its own entries of x.
+ */
+#ifndef PARALLEL_MATRIX_VECTOR_PRODUCT_H
+#define PARALLEL_MATRIX_VECTOR_PRODUCT_H
+#include "Vector.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ModelType>
+class ParallelMatrixVectorProduct {
+
+	typedef typename ModelType::BasisBaseType BasisBaseType;
+	typedef typename ModelType::VectorType VectorType;
+	typedef typename ModelType::RealType RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	class MatrixVectorHelper {
+
+	public:
+
+		MatrixVectorHelper(VectorType& x,
+		                   const VectorType& y,
+		                   const ModelType& model,
+		                   const VectorRealType& diag,
+		                   const BasisBaseType& basis)
+		    : x_(x),y_(y),model_(model),diag_(diag),basis_(basis)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			bool hasDiagonal = (diag_.size() > 0);
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType ispace = threadNum*blockSize + p;
+				if (ispace>=total) break;
+				if (hasDiagonal) x_[ispace] += diag_[ispace]*y_[ispace];
+				x_[ispace] += model_.offDiagonalProduct(y_,ispace,basis_);
+			}
+		}
+
+	private:
+
+		VectorType& x_;
+		const VectorType& y_;
+		const ModelType& model_;
+		const VectorRealType& diag_;
+		const BasisBaseType& basis_;
+	}; // class MatrixVectorHelper
+
+public:
+
+	// diag may be empty, and then only off-diagonal terms are added
+	ParallelMatrixVectorProduct(const ModelType& model,
+	                            const VectorRealType& diag,
+	                            const BasisBaseType& basis,
+	                            SizeType threads)
+	    : model_(model),diag_(diag),basis_(basis),threads_(threads)
+	{}
+
+	void operator()(VectorType& x,const VectorType& y) const
+	{
+		SizeType hilbert = basis_.size();
+		assert(x.size() == hilbert && y.size() == hilbert);
+		assert(diag_.size() == 0 || diag_.size() == hilbert);
+
+		typedef PsimagLite::Parallelizer<MatrixVectorHelper> ParallelizerType;
+		MatrixVectorHelper helper(x,y,model_,diag_,basis_);
+		ParallelizerType threadObject(threads_,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(hilbert,helper);
+	}
+
+private:
+
+	const ModelType& model_;
+	const VectorRealType& diag_;
+	const BasisBaseType& basis_;
+	SizeType threads_;
+}; // class ParallelMatrixVectorProduct
+} // namespace LanczosPlusPlus
+#endif // PARALLEL_MATRIX_VECTOR_PRODUCT_H
+
@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2009-2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+#ifndef PARTICLE_HOLE_SYMM_H
+#define PARTICLE_HOLE_SYMM_H
+#include "BitManip.h"
+#include "PairSymmetry.h"
+
+namespace LanczosPlusPlus {
+
+/* Particle-hole transformation C, with c_{i sigma} -> e_i c^dagger_{i sigma}
+   and e_i = +1 (-1) on sublattice A (B) of the hopping graph.
+   It maps the word ket of each spin to ~ket & mask, so it needs
+   nup == ndown == sites/2. Emptying the ordered string of a full
+   word gives the sign (-1)^i per removed electron at i, so
+   C|i> = prod_{occupied k} e_k (-1)^k |j>, up to a sign that is the
+   same for the whole sector and is dropped; then C^2 = 1.
+   Hopping between sublattices and uniform U and potentialV commute
+   with C. No state is its own image. */
+template<typename GeometryType,typename BasisType>
+class ParticleHoleImage {
+
+	typedef typename GeometryType::ComplexOrRealType ComplexOrRealType;
+	typedef ProgramGlobals::WordType WordType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
+
+public:
+
+	ParticleHoleImage(const BasisType& basis,const GeometryType& geometry)
+	    : basis_(basis),mask_(0),signMask_(0)
+	{
+		if (basis.size() == 0) return;
+
+		if (basis.orbs() != 1)
+			throw PsimagLite::RuntimeError("ParticleHoleSymmetry: needs one orbital\n");
+
+		SizeType n = geometry.numberOfSites();
+		SizeType nup = PsimagLite::BitManip::count(basis(0,SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis(0,SPIN_DOWN));
+		if (2*nup != n || 2*ndown != n)
+			throw PsimagLite::RuntimeError("ParticleHoleSymmetry: needs half filling\n");
+
+		VectorSizeType sublattice;
+		findSublattices(sublattice,geometry);
+		for (SizeType i=0;i<n;i++) {
+			mask_ |= (WordType(1) << i);
+			// e_i (-1)^i
+			if ((sublattice[i] + i) & 1) signMask_ |= (WordType(1) << i);
+		}
+	}
+
+	static PsimagLite::String className() { return "ParticleHoleSymmetry"; }
+
+	static PsimagLite::String name() { return "particlehole"; }
+
+	// C|ispace> = s|image>, with s the same for both states
+	SizeType image(SizeType ispace,int& sign) const
+	{
+		WordType ket1 = basis_(ispace,SPIN_UP);
+		WordType ket2 = basis_(ispace,SPIN_DOWN);
+		SizeType c = PsimagLite::BitManip::count(ket1 & signMask_) +
+		        PsimagLite::BitManip::count(ket2 & signMask_);
+		if (c & 1) sign = -sign;
+		return basis_.perfectIndex((~ket1) & mask_,(~ket2) & mask_);
+	}
+
+private:
+
+	// Two-colors the graph of the hoppings (term 0) of the geometry;
+	// sublattice[i] is 0 for A and 1 for B
+	void findSublattices(VectorSizeType& sublattice,const GeometryType& geometry) const
+	{
+		SizeType n = geometry.numberOfSites();
+		SizeType unset = 2;
+		sublattice.assign(n,unset);
+		VectorSizeType stack;
+		for (SizeType root=0;root<n;root++) {
+			if (sublattice[root] != unset) continue;
+			sublattice[root] = 0;
+			stack.push_back(root);
+			while (stack.size() > 0) {
+				SizeType i = stack.back();
+				stack.pop_back();
+				for (SizeType j=0;j<n;j++) {
+					if (i == j) continue;
+					ComplexOrRealType t = geometry(i,0,j,0,0);
+					if (PsimagLite::norm(t) < 1e-12) continue;
+					if (fabs(PsimagLite::imag(t)) > 1e-12)
+						throwNoSymmetry(" hoppings are not real.");
+					if (sublattice[j] == sublattice[i])
+						throwNoSymmetry(" hoppings are not bipartite.");
+					if (sublattice[j] != unset) continue;
+					sublattice[j] = 1 - sublattice[i];
+					stack.push_back(j);
+				}
+			}
+		}
+	}
+
+	void throwNoSymmetry(PsimagLite::String what) const
+	{
+		PsimagLite::String s(__FILE__);
+		s += " Hamiltonian has no particle-hole symmetry:" + what;
+		throw std::runtime_error(s.c_str());
+	}
+
+	const BasisType& basis_;
+	WordType mask_;
+	WordType signMask_;
+}; // class ParticleHoleImage
+
+// Sector 0 is even under C, sector 1 is odd
+template<typename GeometryType_,typename BasisType>
+class ParticleHoleSymmetry
+        : public PairSymmetry<GeometryType_,BasisType,ParticleHoleImage<GeometryType_,BasisType> > {
+
+	typedef ParticleHoleImage<GeometryType_,BasisType> ImageType;
+	typedef PairSymmetry<GeometryType_,BasisType,ImageType> BaseType;
+
+public:
+
+	ParticleHoleSymmetry(const BasisType& basis,
+	                     const GeometryType_& geometry,
+	                     PsimagLite::String options)
+	    : BaseType(basis,geometry,options)
+	{}
+}; // class ParticleHoleSymmetry
+} // namespace LanczosPlusPlus
+
+#endif  // PARTICLE_HOLE_SYMM_H
@@ -0,0 +1,97 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file SectorExpansion.h
+ *
+ *  Expands a vector of one sector of a special symmetry into the
+ *  real-space basis, in one threaded pass over real-space states.
+ *
+ *  The symmetry provides
+ *  ComplexOrRealType realSpaceComponent(const VectorType& v,SizeType p,
+ *                                       SizeType ispace) const
+ *  with the component ispace of the real-space form of the vector v
+ *  of sector p, found from the representative and phase tables of the
+ *  symmetry. Each thread writes its own components, and no transform
+ *  matrix is needed.
+ */
+#ifndef SECTOR_EXPANSION_H
+#define SECTOR_EXPANSION_H
+#include "Vector.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename SymmetryType>
+class SectorExpansion {
+
+	typedef typename SymmetryType::VectorType VectorType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	class ExpansionHelper {
+
+	public:
+
+		ExpansionHelper(VectorType& dest,
+		                const VectorType& src,
+		                const SymmetryType& symm,
+		                SizeType p)
+		    : dest_(dest),src_(src),symm_(symm),p_(p)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType ispace = threadNum*blockSize + p;
+				if (ispace>=total) break;
+				dest_[ispace] = symm_.realSpaceComponent(src_,p_,ispace);
+			}
+		}
+
+	private:
+
+		VectorType& dest_;
+		const VectorType& src_;
+		const SymmetryType& symm_;
+		SizeType p_;
+	}; // class ExpansionHelper
+
+public:
+
+	// dest is resized to hilbert
+	static void expand(VectorType& dest,
+	                   const VectorType& src,
+	                   const SymmetryType& symm,
+	                   SizeType p,
+	                   SizeType hilbert)
+	{
+		dest.resize(hilbert);
+		typedef PsimagLite::Parallelizer<ExpansionHelper> ParallelizerType;
+		ExpansionHelper helper(dest,src,symm,p);
+		ParallelizerType threadObject(ConcurrencyType::npthreads,
+		                              PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(hilbert,helper);
+	}
+}; // class SectorExpansion
+} // namespace LanczosPlusPlus
+
+#endif  // SECTOR_EXPANSION_H
@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2009-2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+#ifndef SPIN_FLIP_SYMM_H
+#define SPIN_FLIP_SYMM_H
+#include "BitManip.h"
+#include "PairSymmetry.h"
+
+namespace LanczosPlusPlus {
+
+/* Global exchange F of up and down electrons, for nup == ndown.
+   With all up operators to the left of all down ones, exchanging the
+   two strings gives F|up,down> = (-1)^(nup*ndown)|down,up>. */
+template<typename GeometryType,typename BasisType>
+class SpinFlipImage {
+
+	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
+
+public:
+
+	SpinFlipImage(const BasisType& basis,const GeometryType&)
+	    : basis_(basis),sign_(1)
+	{
+		if (basis.size() == 0) return;
+
+		SizeType nup = PsimagLite::BitManip::count(basis(0,SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis(0,SPIN_DOWN));
+		if (nup != ndown)
+			throw PsimagLite::RuntimeError("SpinFlipSymmetry: needs nup == ndown\n");
+
+		if ((nup*ndown) & 1) sign_ = -1;
+	}
+
+	static PsimagLite::String className() { return "SpinFlipSymmetry"; }
+
+	static PsimagLite::String name() { return "spinflip"; }
+
+	SizeType image(SizeType ispace,int& sign) const
+	{
+		sign *= sign_;
+		return basis_.perfectIndex(basis_(ispace,SPIN_DOWN),basis_(ispace,SPIN_UP));
+	}
+
+private:
+
+	const BasisType& basis_;
+	int sign_;
+}; // class SpinFlipImage
+
+// Sector 0 is even under F, sector 1 is odd
+template<typename GeometryType_,typename BasisType>
+class SpinFlipSymmetry
+        : public PairSymmetry<GeometryType_,BasisType,SpinFlipImage<GeometryType_,BasisType> > {
+
+	typedef SpinFlipImage<GeometryType_,BasisType> ImageType;
+	typedef PairSymmetry<GeometryType_,BasisType,ImageType> BaseType;
+
+public:
+
+	SpinFlipSymmetry(const BasisType& basis,
+	                 const GeometryType_& geometry,
+	                 PsimagLite::String options)
+	    : BaseType(basis,geometry,options)
+	{}
+}; // class SpinFlipSymmetry
+} // namespace LanczosPlusPlus
+
+#endif  // SPIN_FLIP_SYMM_H
@@ -0,0 +1,285 @@
+/*
+Copyright (c) 2009-2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+#ifndef SYMMETRY_DETECTOR_H
+#define SYMMETRY_DETECTOR_H
+#include <iostream>
+#include <algorithm>
+#include "ProgressIndicator.h"
+#include "Vector.h"
+#include "BitManip.h"
+#include "SymmetryGroup.h"
+
+namespace LanczosPlusPlus {
+
+/* Finds which generators of SymmetryGroup hold for a model, before
+   anything Hilbert-sized is built but its diagonal.
+   A candidate (Translation0, Translation1, Reflection, SpinFlip) holds
+   if all couplings of the geometry, all terms and orbitals, are
+   invariant under its site permutation, and if the diagonal of H, with
+   hubbardU, potentialV and the other on-site terms, is the same on
+   each state and its image. Off-diagonal terms that are not geometry
+   couplings are not checked.
+   generators() is the commuting subset of the candidates that gives
+   the largest group, as SolverOptions tokens, empty if none holds. */
+template<typename ModelType>
+class SymmetryDetector {
+
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename ModelType::GeometryType GeometryType;
+	typedef typename ModelType::ComplexOrRealType ComplexOrRealType;
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::VectorRealType VectorRealType;
+	typedef SymmetryGenerator<BasisType> GeneratorType;
+	typedef typename PsimagLite::Vector<GeneratorType>::Type VectorGeneratorType;
+	typedef typename GeneratorType::VectorSizeType VectorSizeType;
+
+public:
+
+	SymmetryDetector(const ModelType& model)
+	    : progress_("SymmetryDetector"),
+	      model_(model)
+	{
+		PsimagLite::String reason = checkBasis(model.basis());
+		if (reason != "") {
+			report("none: " + reason);
+			return;
+		}
+
+		VectorGeneratorType candidates;
+		addCandidates(candidates);
+
+		VectorGeneratorType valid;
+		VectorRealType diag;
+		for (SizeType j=0;j<candidates.size();j++) {
+			const GeneratorType& g = candidates[j];
+			PsimagLite::String reason = checkCouplings(g);
+			if (reason == "") reason = checkDiagonal(diag,g);
+			if (reason == "") {
+				valid.push_back(g);
+				report(g.name() + "(" + ttos(g.order()) + ") holds");
+			} else {
+				report(g.name() + " fails: " + reason);
+			}
+		}
+
+		chooseGroup(valid);
+		report("using " + ((generators_ == "") ? PsimagLite::String("none") : generators_));
+	}
+
+	const PsimagLite::String& generators() const { return generators_; }
+
+private:
+
+	void report(PsimagLite::String str)
+	{
+		PsimagLite::OstringStream msg;
+		msg<<str;
+		progress_.printline(msg,std::cout);
+	}
+
+	// SymmetryGroup needs one orbital per site and two spin species;
+	// some bases throw on orbs() or dofs()
+	static PsimagLite::String checkBasis(const BasisType& basis)
+	{
+		try {
+			if (basis.orbs() != 1) return "SymmetryGroup needs one orbital per site";
+			if (basis.dofs() != 2) return "SymmetryGroup needs spin-1/2 fermions";
+		} catch (std::exception&) {
+			return "this basis has no orbitals and spins per site";
+		}
+
+		return "";
+	}
+
+	// A candidate whose site map cannot be made, is the identity, or
+	// needs complex characters with the real template is not a candidate
+	void addCandidates(VectorGeneratorType& candidates)
+	{
+		const GeometryType& geometry = model_.geometry();
+		SizeType n = geometry.numberOfSites();
+		SizeType termId = 0;
+		VectorSizeType siteMap(n);
+		for (SizeType dir=0;dir<3;dir++) {
+			PsimagLite::String name = (dir < 2) ? "Translation" + ttos(dir) : "Reflection";
+			try {
+				for (SizeType site=0;site<n;site++)
+					siteMap[site] = (dir < 2) ? geometry.translate(site,dir,1,termId)
+					                          : geometry.findReflection(site,termId);
+				addCandidate(candidates,GeneratorType(name,siteMap,false));
+			} catch (std::exception& e) {
+				report(name + " not available: " + e.what());
+			}
+		}
+
+		const BasisType& basis = model_.basis();
+		if (basis.size() == 0) return;
+		SizeType nup = PsimagLite::BitManip::count(basis(0,ProgramGlobals::SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis(0,ProgramGlobals::SPIN_DOWN));
+		if (nup != ndown) return;
+		for (SizeType site=0;site<n;site++)
+			siteMap[site] = site;
+		addCandidate(candidates,GeneratorType("SpinFlip",siteMap,true));
+	}
+
+	void addCandidate(VectorGeneratorType& candidates,const GeneratorType& g)
+	{
+		if (g.order() == 1) return;
+		if (g.order() > 2 && !isComplex(ComplexOrRealType())) {
+			report(g.name() + " needs the complex template");
+			return;
+		}
+
+		candidates.push_back(g);
+	}
+
+	static bool isComplex(const RealType&) { return false; }
+
+	static bool isComplex(const std::complex<RealType>&) { return true; }
+
+	// t(g(i),g(j)) == t(i,j) for all couplings
+	PsimagLite::String checkCouplings(const GeneratorType& g) const
+	{
+		const GeometryType& geometry = model_.geometry();
+		SizeType n = geometry.numberOfSites();
+		for (SizeType term=0;term<geometry.terms();term++) {
+			for (SizeType i=0;i<n;i++) {
+				for (SizeType j=0;j<n;j++) {
+					SizeType orbsI = geometry.orbitals(term,i);
+					SizeType orbsJ = geometry.orbitals(term,j);
+					for (SizeType o1=0;o1<orbsI;o1++) {
+						for (SizeType o2=0;o2<orbsJ;o2++) {
+							ComplexOrRealType t1 = geometry(i,o1,j,o2,term);
+							ComplexOrRealType t2 = geometry(g.site(i),o1,g.site(j),o2,term);
+							if (PsimagLite::norm(t1 - t2) > 1e-12)
+								return "couplings of term " + ttos(term) +
+								        " differ at sites " + ttos(i) + "," + ttos(j);
+						}
+					}
+				}
+			}
+		}
+
+		return "";
+	}
+
+	// The diagonal is computed once, for the first candidate that
+	// gets here. A basis that cannot index the image of a state, as
+	// for spins, rejects the candidate
+	PsimagLite::String checkDiagonal(VectorRealType& diag,const GeneratorType& g) const
+	{
+		const BasisType& basis = model_.basis();
+		SizeType hilbert = basis.size();
+		try {
+			if (diag.size() != hilbert) {
+				diag.resize(hilbert);
+				for (SizeType ispace=0;ispace<hilbert;ispace++)
+					diag[ispace] = model_.diagonalElement(ispace,basis);
+			}
+		} catch (std::exception& e) {
+			diag.clear();
+			return "cannot check the diagonal of this model";
+		}
+
+		try {
+			for (SizeType ispace=0;ispace<hilbert;ispace++) {
+				int sign = 1;
+				SizeType image = g.apply(ispace,sign,basis);
+				if (fabs(diag[ispace] - diag[image]) > 1e-10)
+					return "on-site terms (hubbardU, potentialV, ...) differ";
+			}
+		} catch (std::exception& e) {
+			return "cannot map the states of this basis";
+		}
+
+		return "";
+	}
+
+	// Largest product of orders over subsets of commuting generators
+	// that make a direct product
+	void chooseGroup(const VectorGeneratorType& valid)
+	{
+		SizeType m = valid.size();
+		SizeType bestOrder = 1;
+		SizeType bestSubset = 0;
+		for (SizeType subset=1;subset<(SizeType(1)<<m);subset++) {
+			SizeType order = 1;
+			bool commuting = true;
+			for (SizeType j=0;j<m && commuting;j++) {
+				if (!(subset & (SizeType(1)<<j))) continue;
+				order *= valid[j].order();
+				for (SizeType i=0;i<j;i++) {
+					if (!(subset & (SizeType(1)<<i))) continue;
+					if (!valid[i].commutesWith(valid[j])) commuting = false;
+				}
+			}
+
+			if (!commuting || order <= bestOrder) continue;
+			if (!isDirectProduct(valid,subset,order)) continue;
+			bestOrder = order;
+			bestSubset = subset;
+		}
+
+		generators_ = "";
+		for (SizeType j=0;j<m;j++) {
+			if (!(bestSubset & (SizeType(1)<<j))) continue;
+			if (generators_ != "") generators_ += ",";
+			generators_ += valid[j].name();
+		}
+	}
+
+	// True if the elements g_0^{r_0}...g_{m-1}^{r_{m-1}} of the subset are
+	// all different, as SymmetryGroup assumes; for example, Translation1
+	// is Translation0 on a chain
+	bool isDirectProduct(const VectorGeneratorType& valid,
+	                     SizeType subset,
+	                     SizeType order) const
+	{
+		SizeType n = model_.geometry().numberOfSites();
+		typename PsimagLite::Vector<VectorSizeType>::Type elements(order);
+		for (SizeType e=0;e<order;e++) {
+			// last entry is 1 if spins are exchanged
+			VectorSizeType& element = elements[e];
+			element.resize(n + 1);
+			for (SizeType site=0;site<n;site++)
+				element[site] = site;
+			element[n] = 0;
+			SizeType digits = e;
+			for (SizeType j=0;j<valid.size();j++) {
+				if (!(subset & (SizeType(1)<<j))) continue;
+				const GeneratorType& g = valid[j];
+				SizeType r = digits % g.order();
+				digits /= g.order();
+				for (SizeType k=0;k<r;k++) {
+					for (SizeType site=0;site<n;site++)
+						element[site] = g.site(element[site]);
+					if (g.swapsSpins()) element[n] = 1 - element[n];
+				}
+			}
+		}
+
+		std::sort(elements.begin(),elements.end());
+		return (std::unique(elements.begin(),elements.end()) == elements.end());
+	}
+
+	PsimagLite::ProgressIndicator progress_;
+	const ModelType& model_;
+	PsimagLite::String generators_;
+}; // class SymmetryDetector
+} // namespace LanczosPlusPlus
+
+#endif  // SYMMETRY_DETECTOR_H
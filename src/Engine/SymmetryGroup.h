@@ -0,0 +1,887 @@
+/*
+Copyright (c) 2009-2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+#ifndef SYMMETRY_GROUP_H
+#define SYMMETRY_GROUP_H
+#include <iostream>
+#include <algorithm>
+#include "ProgressIndicator.h"
+#include "CrsMatrix.h"
+#include "Vector.h"
+#include "SparseRow.h"
+#include "BitManip.h"
+#include "TypeToString.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "DiagonalCache.h"
+#include "ParallelHamiltonianSetup.h"
+#include "SectorExpansion.h"
+
+namespace LanczosPlusPlus {
+
+/* A permutation of the sites, optionally followed by the exchange of
+   up and down electrons. The sign rule is fermionic: the parity of the
+   reordering of the occupied sites of each word, times (-1)^(nup*ndown)
+   if the spins are exchanged, with all up operators to the left of all
+   down ones. */
+template<typename BasisType>
+class SymmetryGenerator {
+
+	typedef typename BasisType::WordType WordType;
+	typedef typename PsimagLite::Vector<WordType>::Type VectorWordType;
+
+	static int const FERMION_SIGN = -1;
+
+	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
+
+public:
+
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
+	SymmetryGenerator(PsimagLite::String name,
+	                  const VectorSizeType& siteMap,
+	                  bool swapSpins)
+	    : name_(name),siteMap_(siteMap),swapSpins_(swapSpins),order_(1)
+	{
+		SizeType n = siteMap_.size();
+		PsimagLite::Vector<bool>::Type seen(n,false);
+		for (SizeType site=0;site<n;site++) {
+			if (siteMap_[site] >= n || seen[siteMap_[site]])
+				throw PsimagLite::RuntimeError("SymmetryGenerator: " + name_ +
+				                               " is not a permutation\n");
+			seen[siteMap_[site]] = true;
+		}
+
+		// order is the lcm of the cycle lengths
+		seen.assign(n,false);
+		for (SizeType site=0;site<n;site++) {
+			if (seen[site]) continue;
+			SizeType length = 0;
+			SizeType current = site;
+			do {
+				seen[current] = true;
+				current = siteMap_[current];
+				length++;
+			} while (current != site);
+			order_ = lcm(order_,length);
+		}
+
+		if (swapSpins_) order_ = lcm(order_,2);
+	}
+
+	const PsimagLite::String& name() const { return name_; }
+
+	SizeType order() const { return order_; }
+
+	SizeType site(SizeType i) const { return siteMap_[i]; }
+
+	bool swapsSpins() const { return swapSpins_; }
+
+	bool commutesWith(const SymmetryGenerator& other) const
+	{
+		SizeType n = siteMap_.size();
+		if (other.siteMap_.size() != n) return false;
+		for (SizeType site=0;site<n;site++)
+			if (siteMap_[other.siteMap_[site]] != other.siteMap_[siteMap_[site]])
+				return false;
+		return true;
+	}
+
+	// Index of g|state>; sign is multiplied by the fermion sign
+	SizeType apply(SizeType state,int& sign,const BasisType& basis) const
+	{
+		SizeType numberOfDofs = basis.dofs();
+		VectorWordType y(numberOfDofs,0);
+
+		for (SizeType dof=0;dof<numberOfDofs;dof++)
+			y[dof] = permuteWord(basis(state,dof),sign);
+
+		if (swapSpins_) {
+			SizeType nup = PsimagLite::BitManip::count(y[SPIN_UP]);
+			SizeType ndown = PsimagLite::BitManip::count(y[SPIN_DOWN]);
+			if ((nup*ndown) & 1) sign *= FERMION_SIGN;
+			std::swap(y[SPIN_UP],y[SPIN_DOWN]);
+		}
+
+		return basis.perfectIndex(y);
+	}
+
+private:
+
+	static SizeType lcm(SizeType a,SizeType b)
+	{
+		SizeType x = a;
+		SizeType y = b;
+		while (y != 0) {
+			SizeType tmp = x % y;
+			x = y;
+			y = tmp;
+		}
+
+		return a/x*b;
+	}
+
+	WordType permuteWord(WordType x,int& sign) const
+	{
+		WordType y = 0;
+		SizeType inversions = 0;
+		for (SizeType site=0;site<siteMap_.size();site++) {
+			if (!x) break;
+			SizeType thisSiteContent = x & 1;
+			x >>= 1;
+			if (thisSiteContent == 0) continue;
+			SizeType tSite = siteMap_[site];
+			inversions += PsimagLite::BitManip::count(y >> tSite);
+			y |= (WordType(1) << tSite);
+		}
+
+		if (inversions & 1) sign *= FERMION_SIGN;
+		return y;
+	}
+
+	PsimagLite::String name_;
+	VectorSizeType siteMap_;
+	bool swapSpins_;
+	SizeType order_;
+}; // class SymmetryGenerator
+
+// Orbit of representative under the group. Elements in
+// [stabilizerBegin,stabilizerEnd) of the stabilizer list leave
+// the representative in place, up to a sign
+struct SymmetryGroupOrbit {
+
+	SymmetryGroupOrbit(SizeType representative_,
+	                   SizeType size_,
+	                   SizeType stabilizerBegin_,
+	                   SizeType stabilizerEnd_)
+	    : representative(representative_),
+	      size(size_),
+	      stabilizerBegin(stabilizerBegin_),
+	      stabilizerEnd(stabilizerEnd_)
+	{}
+
+	SizeType representative;
+	SizeType size;
+	SizeType stabilizerBegin;
+	SizeType stabilizerEnd;
+};
+
+/* Abelian group generated by commuting generators g_0,...,g_{m-1} of
+   orders n_0,...,n_{m-1}, chosen in SolverOptions:
+   TranslationN translates by one site along direction N of the geometry,
+   Reflection uses the reflection of the geometry, and SpinFlip
+   exchanges up and down electrons (nup == ndown only). Only abelian
+   groups are supported: translation and reflection of a ring generate
+   the dihedral group, whose 2D irreps are not built, and are rejected.
+
+   Element e is g_0^{r_0}...g_{m-1}^{r_{m-1}}, with r_j the digits of e
+   in the mixed radix n_0,...,n_{m-1}; irrep q has the characters
+   chi_q(e) = exp(2 pi i sum_j q_j r_j/n_j) and is sector q. Sector q is
+   spanned by (1/sqrt(size)) sum_s conj(chi_q(e_s)) sign_s |s> over the
+   states s of each orbit whose stabilizer has chi_q = sign, where
+   g^{e_s}|rep> = sign_s|s> */
+template<typename GeometryType_,typename BasisType>
+class SymmetryGroup  {
+
+	typedef typename GeometryType_::ComplexOrRealType ComplexOrRealType;
+	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef SymmetryGenerator<BasisType> GeneratorType;
+	typedef typename PsimagLite::Vector<GeneratorType>::Type VectorGeneratorType;
+	typedef SymmetryGroupOrbit OrbitType;
+	typedef PsimagLite::Vector<OrbitType>::Type VectorOrbitType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef std::pair<SizeType,int> ImageType;
+	typedef PsimagLite::Vector<ImageType>::Type VectorImageType;
+	typedef DiagonalCache<RealType,BasisType> DiagonalCacheType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	// x += H_q y in sector q, one row at a time
+	template<typename SomeModelType,typename SomeVectorType>
+	class SectorProductHelper {
+
+		typedef typename SomeModelType::SparseMatrixType ModelSparseMatrixType;
+		typedef typename PsimagLite::Vector<RealType>::Type VectorDiagType;
+		typedef PsimagLite::SparseRow<ModelSparseMatrixType> SparseRowType;
+
+	public:
+
+		SectorProductHelper(SomeVectorType& x,
+		                    const SomeVectorType& y,
+		                    const SymmetryGroup& symm,
+		                    const SomeModelType& model,
+		                    const VectorDiagType& diag,
+		                    SizeType q)
+		    : x_(x),y_(y),symm_(symm),model_(model),diag_(diag),q_(q)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			ModelSparseMatrixType row;
+			SparseRowType sparseRow;
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType a = threadNum*blockSize + p;
+				if (a>=total) break;
+				symm_.setSectorRow(sparseRow,
+				                   row,
+				                   model_,
+				                   symm_.sectors_[q_],
+				                   symm_.characters_[q_],
+				                   a,
+				                   diag_);
+				x_[a] += sparseRow.finalize(y_);
+			}
+		}
+
+	private:
+
+		SomeVectorType& x_;
+		const SomeVectorType& y_;
+		const SymmetryGroup& symm_;
+		const SomeModelType& model_;
+		const VectorDiagType& diag_;
+		SizeType q_;
+	}; // class SectorProductHelper
+
+public:
+
+	typedef GeometryType_ GeometryType;
+	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	SymmetryGroup(const BasisType& basis,
+	              const GeometryType& geometry,
+	              PsimagLite::String options)
+	    : progress_("SymmetryGroup"),
+	      basis_(basis),
+	      elements_(1),
+	      denominator_(2),
+	      pointer_(0),
+	      printMatrix_(options.find("printmatrix")!=PsimagLite::String::npos)
+	{
+		if (basis.orbs() != 1)
+			throw PsimagLite::RuntimeError("SymmetryGroup: one orbital per site only\n");
+
+		setGenerators(geometry,options);
+
+		for (SizeType j=0;j<generators_.size();j++) {
+			elements_ *= generators_[j].order();
+			denominator_ = lcm(denominator_,2*generators_[j].order());
+		}
+
+		checkCharacters(ComplexOrRealType());
+		setOrbits();
+
+		SizeType hilbert = basis.size();
+		blockSizes_.resize(elements_,0);
+		SizeType total = 0;
+		for (SizeType q=0;q<elements_;q++) {
+			for (SizeType i=0;i<orbits_.size();i++)
+				if (hasIrrep(orbits_[i],q)) blockSizes_[q]++;
+			total += blockSizes_[q];
+		}
+
+		if (total!=hilbert) {
+			std::cout<<"Blocksizes summed="<<total;
+			std::cout<<" but hilbert="<<hilbert<<"\n";
+			throw std::runtime_error("error!\n");
+		}
+
+		SizeType nonEmpty = 0;
+		sectors_.resize(elements_);
+		characters_.resize(elements_);
+		for (SizeType q=0;q<elements_;q++) {
+			if (blockSizes_[q] > 0) nonEmpty++;
+			fillSector(sectors_[q],q);
+			fillCharacters(characters_[q],q);
+		}
+
+		PsimagLite::OstringStream msg;
+		msg<<"generators";
+		for (SizeType j=0;j<generators_.size();j++)
+			msg<<" "<<generators_[j].name()<<"("<<generators_[j].order()<<")";
+		msg<<", "<<orbits_.size()<<" orbits, "<<nonEmpty<<" of "<<elements_;
+		msg<<" sectors not empty";
+		progress_.printline(msg,std::cout);
+	}
+
+	// Fills all blocks row by row; the full Hamiltonian is never stored.
+	// Each row is also compared with the row of its image under each
+	// generator, as the generators chosen in SolverOptions may not
+	// commute with H
+	template<typename SomeModelType>
+	void init(const SomeModelType& model,const BasisType& basis)
+	{
+		checkBasis(basis);
+		typedef typename SomeModelType::SparseMatrixType ModelSparseMatrixType;
+		typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
+
+		const VectorRealType& diag = diagonalCache_(model,basis);
+		checkDiagonal(diag);
+		ModelSparseMatrixType row;
+		ModelSparseMatrixType imageRow;
+		for (SizeType ispace=0;ispace<basis_.size();ispace++)
+			checkRow(row,imageRow,model,ispace,diag);
+
+		SparseRowType sparseRow;
+		matrixStored_.resize(elements_);
+		for (SizeType q=0;q<elements_;q++) {
+			const VectorSizeType& sector = sectors_[q];
+			const VectorType& characters = characters_[q];
+			SizeType rank = sector.size();
+			SparseMatrixType& m = matrixStored_[q];
+			m.resize(rank,rank);
+			SizeType counter = 0;
+			for (SizeType a=0;a<rank;a++) {
+				m.setRow(a,counter);
+				setSectorRow(sparseRow,row,model,sector,characters,a,diag);
+				counter += sparseRow.finalize(m);
+			}
+
+			m.setRow(rank,counter);
+			m.checkValidity();
+		}
+
+		int nrows = matrixStored_[0].row();
+		if (printMatrix_) {
+			if (nrows > 40)
+				throw PsimagLite::RuntimeError("printMatrix too big\n");
+			std::cout<<matrixStored_[0].toDense();
+		}
+	}
+
+	SizeType rank() const { return rank(pointer_); }
+
+	SizeType rank(SizeType q) const { return matrixStored_[q].row(); }
+
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
+	{
+		matrixVectorProduct(x,y,pointer_);
+	}
+
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y,SizeType q) const
+	{
+		return matrixStored_[q].matrixVectorProduct(x,y);
+	}
+
+	// On the fly the rows of a sector are made when needed; the
+	// diagonal is computed here so that sectors can then be used
+	// from several threads
+	template<typename SomeModelType>
+	void initOnTheFly(const SomeModelType& model,const BasisType& basis)
+	{
+		checkBasis(basis);
+		checkDiagonal(diagonalCache_(model,basis));
+	}
+
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType&,const BasisType&) const
+	{
+		return sectors_[pointer_].size();
+	}
+
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType&,const BasisType&,SizeType q) const
+	{
+		return sectors_[q].size();
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis) const
+	{
+		matrixVectorProduct(x,y,model,basis,pointer_,ConcurrencyType::npthreads);
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis,
+	                         SizeType q,
+	                         SizeType threads) const
+	{
+		SizeType rank = sectors_[q].size();
+		assert(x.size() == rank && y.size() == rank);
+		typedef SectorProductHelper<SomeModelType,SomeVectorType> HelperType;
+		typedef PsimagLite::Parallelizer<HelperType> ParallelizerType;
+		HelperType helper(x,y,*this,model,diagonalCache_(model,basis,threads),q);
+		ParallelizerType threadObject(threads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(rank,helper);
+	}
+
+	// gs is in the sector that starts at offset
+	void transformGs(VectorType& gs,SizeType offset)
+	{
+		SizeType q = 0;
+		SizeType start = 0;
+		for (;q<blockSizes_.size();q++) {
+			if (start == offset && blockSizes_[q] > 0) break;
+			start += blockSizes_[q];
+		}
+
+		if (q == blockSizes_.size() || blockSizes_[q] != gs.size())
+			throw PsimagLite::RuntimeError("SymmetryGroup: wrong offset\n");
+
+		VectorType gstmp;
+		SectorExpansion<SymmetryGroup>::expand(gstmp,gs,*this,q,basis_.size());
+		gs.swap(gstmp);
+	}
+
+	// Component ispace of the real-space form of v, of sector q: with
+	// g^e|ispace> = sign|rep_b>, <ispace|b> = sign chi(e)/sqrt(size_b)
+	ComplexOrRealType realSpaceComponent(const VectorType& v,
+	                                     SizeType q,
+	                                     SizeType ispace) const
+	{
+		const VectorSizeType& sector = sectors_[q];
+		SizeType b = findInSector(sector,orbitOf_[ispace]);
+		if (b >= sector.size()) return 0.0;
+		RealType factor = sign_[ispace]/sqrt(static_cast<RealType>(orbits_[sector[b]].size));
+		return characters_[q][element_[ispace]]*factor*v[b];
+	}
+
+	// Components of the real-space vector src in sector q
+	void transformToSector(VectorType& dest,const VectorType& src,SizeType q) const
+	{
+		const VectorSizeType& sector = sectors_[q];
+		const VectorType& characters = characters_[q];
+		dest.resize(sector.size());
+		VectorImageType images;
+		VectorSizeType first;
+		for (SizeType a=0;a<sector.size();a++) {
+			const OrbitType& orbit = orbits_[sector[a]];
+			RealType norm = 1.0/sqrt(static_cast<RealType>(orbit.size));
+			fillOrbitStates(first,images,orbit.representative);
+			dest[a] = 0.0;
+			for (SizeType i=0;i<first.size();i++) {
+				SizeType e = first[i];
+				dest[a] += characters[e]*(images[e].second*norm)*src[images[e].first];
+			}
+		}
+	}
+
+	SizeType sectors() const { return elements_; }
+
+	// Stored elements, for the memory estimate of the sector cache
+	SizeType nonZeros() const
+	{
+		SizeType sum = 0;
+		for (SizeType i=0;i<matrixStored_.size();i++)
+			sum += matrixStored_[i].nonZeros();
+		return sum;
+	}
+
+	void setPointer(SizeType p) { pointer_=p; }
+
+	PsimagLite::String name() const { return "symmetrygroup"; }
+
+	void fullDiag(VectorRealType& eigs,MatrixType& fm) const
+	{
+		if (matrixStored_[pointer_].row() > 1000)
+			throw PsimagLite::RuntimeError("fullDiag too big\n");
+
+		fm = matrixStored_[pointer_].toDense();
+		diag(fm,eigs,'V');
+
+		if (!printMatrix_) return;
+
+		for (SizeType i=0;i<eigs.size();i++)
+			std::cout<<eigs[i]<<"\n";
+		std::cout<<fm;
+	}
+
+private:
+
+	// Orders element indices by the state they send to
+	class ByState {
+
+	public:
+
+		ByState(const VectorImageType& images) : images_(images) {}
+
+		bool operator()(SizeType e1,SizeType e2) const
+		{
+			return (images_[e1].first < images_[e2].first);
+		}
+
+	private:
+
+		const VectorImageType& images_;
+	}; // class ByState
+
+	static SizeType lcm(SizeType a,SizeType b)
+	{
+		SizeType x = a;
+		SizeType y = b;
+		while (y != 0) {
+			SizeType tmp = x % y;
+			x = y;
+			y = tmp;
+		}
+
+		return a/x*b;
+	}
+
+	void checkBasis(const BasisType& basis) const
+	{
+		if (&basis != &basis_)
+			throw PsimagLite::RuntimeError("SymmetryGroup: wrong basis\n");
+	}
+
+	void throwNoSymmetry(const GeneratorType& g,PsimagLite::String what) const
+	{
+		PsimagLite::String s(__FILE__);
+		s += " Hamiltonian has no " + g.name() + " symmetry:" + what;
+		throw std::runtime_error(s.c_str());
+	}
+
+	void checkDiagonal(const VectorRealType& diag) const
+	{
+		for (SizeType j=0;j<generators_.size();j++) {
+			for (SizeType ispace=0;ispace<diag.size();ispace++) {
+				int sign = 1;
+				SizeType image = generators_[j].apply(ispace,sign,basis_);
+				if (fabs(diag[ispace] - diag[image]) > 1e-10)
+					throwNoSymmetry(generators_[j]," diagonal differs.");
+			}
+		}
+	}
+
+	// With g|s> = sign_s|g(s)>, <g(c)|H|g(s)> = sign_c sign_s <c|H|s>
+	template<typename SomeModelType>
+	void checkRow(typename SomeModelType::SparseMatrixType& row,
+	              typename SomeModelType::SparseMatrixType& imageRow,
+	              const SomeModelType& model,
+	              SizeType ispace,
+	              const VectorRealType& diag) const
+	{
+		typedef ParallelHamiltonianSetup<SomeModelType> SetupType;
+		SizeType n = SetupType::setupRow(row,model,ispace,diag,basis_);
+		for (SizeType j=0;j<generators_.size();j++) {
+			const GeneratorType& g = generators_[j];
+			int sign = 1;
+			SizeType image = g.apply(ispace,sign,basis_);
+			SizeType m = SetupType::setupRow(imageRow,model,image,diag,basis_);
+			if (nonZeros(row,n) != nonZeros(imageRow,m))
+				throwNoSymmetry(g," hoppings differ.");
+
+			for (SizeType t=0;t<n;t++) {
+				int colSign = sign;
+				SizeType col = g.apply(row.getCol(t),colSign,basis_);
+				ComplexOrRealType val = 0.0;
+				for (SizeType u=0;u<m;u++) {
+					if (SizeType(imageRow.getCol(u)) != col) continue;
+					val = imageRow.getValue(u);
+					break;
+				}
+
+				if (PsimagLite::norm(row.getValue(t)*RealType(colSign) - val) > 1e-12)
+					throwNoSymmetry(g," hoppings differ.");
+			}
+		}
+	}
+
+	template<typename SomeSparseMatrixType>
+	static SizeType nonZeros(const SomeSparseMatrixType& row,SizeType n)
+	{
+		SizeType c = 0;
+		for (SizeType t=0;t<n;t++)
+			if (PsimagLite::norm(row.getValue(t)) > 1e-12) c++;
+		return c;
+	}
+
+	void setGenerators(const GeometryType& geometry,const PsimagLite::String& options)
+	{
+		SizeType n = geometry.numberOfSites();
+		VectorSizeType siteMap(n);
+		SizeType termId = 0;
+		for (SizeType dir=0;dir<2;dir++) {
+			PsimagLite::String label = "Translation" + ttos(dir);
+			if (options.find(label) == PsimagLite::String::npos) continue;
+			for (SizeType site=0;site<n;site++)
+				siteMap[site] = geometry.translate(site,dir,1,termId);
+			generators_.push_back(GeneratorType(label,siteMap,false));
+		}
+
+		if (options.find("Reflection") != PsimagLite::String::npos) {
+			for (SizeType site=0;site<n;site++)
+				siteMap[site] = geometry.findReflection(site,termId);
+			generators_.push_back(GeneratorType("Reflection",siteMap,false));
+		}
+
+		if (options.find("SpinFlip") != PsimagLite::String::npos) {
+			checkSpinFlip();
+			for (SizeType site=0;site<n;site++)
+				siteMap[site] = site;
+			generators_.push_back(GeneratorType("SpinFlip",siteMap,true));
+		}
+
+		if (generators_.size() == 0)
+			throw PsimagLite::RuntimeError("SymmetryGroup: no generators in SolverOptions\n");
+
+		for (SizeType j=0;j<generators_.size();j++) {
+			for (SizeType i=0;i<j;i++) {
+				if (generators_[i].commutesWith(generators_[j])) continue;
+				PsimagLite::String str("SymmetryGroup: ");
+				str += generators_[i].name() + " and " + generators_[j].name();
+				str += " do not commute; only abelian groups are supported\n";
+				throw PsimagLite::RuntimeError(str);
+			}
+		}
+	}
+
+	void checkSpinFlip() const
+	{
+		if (basis_.dofs() != 2)
+			throw PsimagLite::RuntimeError("SymmetryGroup: SpinFlip needs two spins\n");
+		if (basis_.size() == 0) return;
+		SizeType nup = PsimagLite::BitManip::count(basis_(0,ProgramGlobals::SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis_(0,ProgramGlobals::SPIN_DOWN));
+		if (nup != ndown)
+			throw PsimagLite::RuntimeError("SymmetryGroup: SpinFlip needs nup == ndown\n");
+	}
+
+	void checkCharacters(const std::complex<RealType>&) const {}
+
+	// Real characters only if every generator squares to one
+	void checkCharacters(const RealType&) const
+	{
+		for (SizeType j=0;j<generators_.size();j++) {
+			if (generators_[j].order() <= 2) continue;
+			PsimagLite::String str("SymmetryGroup: ");
+			str += generators_[j].name() + " needs the complex template\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+	}
+
+	// Walks each orbit once, from its smallest state. Each state s of
+	// the orbit keeps, with g^e|rep> = sign|s>, its orbit and the inverse
+	// element, g^{-e}|s> = sign|rep>, so that products need no images
+	void setOrbits()
+	{
+		SizeType hilbert = basis_.size();
+		PsimagLite::Vector<bool>::Type seen(hilbert,false);
+		orbitOf_.resize(hilbert);
+		element_.resize(hilbert);
+		sign_.resize(hilbert);
+		VectorImageType images;
+		for (SizeType ispace=0;ispace<hilbert;ispace++) {
+			if (seen[ispace]) continue;
+
+			fillImages(images,ispace);
+			SizeType size = 0;
+			SizeType stabilizerBegin = stabilizer_.size();
+			for (SizeType e=0;e<images.size();e++) {
+				SizeType state = images[e].first;
+				if (state < ispace)
+					throw PsimagLite::RuntimeError("SymmetryGroup: not a group\n");
+				if (e > 0 && state == ispace)
+					stabilizer_.push_back(ImageType(e,images[e].second));
+				if (seen[state]) continue;
+				seen[state] = true;
+				orbitOf_[state] = orbits_.size();
+				element_[state] = inverse(e);
+				sign_[state] = images[e].second;
+				size++;
+			}
+
+			orbits_.push_back(OrbitType(ispace,size,stabilizerBegin,stabilizer_.size()));
+		}
+	}
+
+	// Index of the element with digits (n_j - r_j) mod n_j
+	SizeType inverse(SizeType e) const
+	{
+		SizeType result = 0;
+		SizeType stride = 1;
+		for (SizeType j=0;j<generators_.size();j++) {
+			SizeType order = generators_[j].order();
+			result += ((order - e % order) % order)*stride;
+			e /= order;
+			stride *= order;
+		}
+
+		return result;
+	}
+
+	// images[e] = (s,sign) with g^e|state> = sign|s>; generator j
+	// is applied to the elements that do not contain g_j yet
+	void fillImages(VectorImageType& images,SizeType state) const
+	{
+		images.resize(elements_);
+		images[0] = ImageType(state,1);
+		SizeType stride = 1;
+		for (SizeType j=0;j<generators_.size();j++) {
+			SizeType order = generators_[j].order();
+			for (SizeType r=1;r<order;r++) {
+				for (SizeType e=0;e<stride;e++) {
+					const ImageType& previous = images[(r-1)*stride + e];
+					int sign = previous.second;
+					SizeType s = generators_[j].apply(previous.first,sign,basis_);
+					images[r*stride + e] = ImageType(s,sign);
+				}
+			}
+
+			stride *= order;
+		}
+	}
+
+	// first holds one element for each state of the orbit of rep,
+	// the smallest one that reaches it
+	void fillOrbitStates(VectorSizeType& first,
+	                     VectorImageType& images,
+	                     SizeType rep) const
+	{
+		fillImages(images,rep);
+		first.resize(images.size());
+		for (SizeType e=0;e<images.size();e++)
+			first[e] = e;
+		std::stable_sort(first.begin(),first.end(),ByState(images));
+		SizeType n = 0;
+		for (SizeType i=0;i<first.size();i++) {
+			if (n > 0 && images[first[n-1]].first == images[first[i]].first) continue;
+			first[n++] = first[i];
+		}
+
+		first.resize(n);
+	}
+
+	// chi_q(e) = exp(2 pi i phase/denominator_)
+	SizeType phase(SizeType q,SizeType e) const
+	{
+		SizeType sum = 0;
+		for (SizeType j=0;j<generators_.size();j++) {
+			SizeType order = generators_[j].order();
+			sum += (q % order)*(e % order)*(denominator_/order);
+			q /= order;
+			e /= order;
+		}
+
+		return sum % denominator_;
+	}
+
+	// The orbit survives the projection on q only if chi_q = sign
+	// on its stabilizer
+	bool hasIrrep(const OrbitType& orbit,SizeType q) const
+	{
+		for (SizeType i=orbit.stabilizerBegin;i<orbit.stabilizerEnd;i++) {
+			SizeType expected = (stabilizer_[i].second > 0) ? 0 : denominator_/2;
+			if (phase(q,stabilizer_[i].first) != expected) return false;
+		}
+
+		return true;
+	}
+
+	// Orbits of irrep q, by increasing representative
+	void fillSector(VectorSizeType& sector,SizeType q) const
+	{
+		sector.clear();
+		sector.reserve(blockSizes_[q]);
+		for (SizeType i=0;i<orbits_.size();i++)
+			if (hasIrrep(orbits_[i],q)) sector.push_back(i);
+	}
+
+	void fillCharacters(VectorType& characters,SizeType q) const
+	{
+		characters.resize(elements_);
+		for (SizeType e=0;e<elements_;e++)
+			characters[e] = character(phase(q,e),ComplexOrRealType());
+	}
+
+	std::complex<RealType> character(SizeType phase,const std::complex<RealType>&) const
+	{
+		RealType tmp = 2*M_PI*phase/RealType(denominator_);
+		return std::complex<RealType>(cos(tmp),sin(tmp));
+	}
+
+	RealType character(SizeType phase,const RealType&) const
+	{
+		if (phase == 0) return 1.0;
+		if (2*phase == denominator_) return -1.0;
+		throw PsimagLite::RuntimeError("SymmetryGroup: complex character\n");
+	}
+
+	// Position of orbit in sector, or sector.size(); a sector lists
+	// its orbits in increasing order
+	SizeType findInSector(const VectorSizeType& sector,SizeType orbit) const
+	{
+		VectorSizeType::const_iterator it = std::lower_bound(sector.begin(),
+		                                                     sector.end(),
+		                                                     orbit);
+		if (it == sector.end() || *it != orbit) return sector.size();
+		return it - sector.begin();
+	}
+
+	// Row a of a sector, from the real-space row of its representative.
+	// The group commutes with H, so <a|H|b> = sqrt(size_a) <rep_a|H|b>;
+	// a column c with g^e|c> = sign|rep_b> has
+	// <c|b> = sign chi(e)/sqrt(size_b)
+	template<typename SomeModelType,typename SparseRowType>
+	void setSectorRow(SparseRowType& sparseRow,
+	                  typename SomeModelType::SparseMatrixType& row,
+	                  const SomeModelType& model,
+	                  const VectorSizeType& sector,
+	                  const VectorType& characters,
+	                  SizeType a,
+	                  const VectorRealType& diag) const
+	{
+		const OrbitType& orbitA = orbits_[sector[a]];
+		SizeType n = ParallelHamiltonianSetup<SomeModelType>::setupRow(row,
+		                                                               model,
+		                                                               orbitA.representative,
+		                                                               diag,
+		                                                               basis_);
+		RealType sizeA = orbitA.size;
+		for (SizeType t=0;t<n;t++) {
+			SizeType col = row.getCol(t);
+			SizeType b = findInSector(sector,orbitOf_[col]);
+			if (b >= sector.size()) continue;
+			RealType factor = sign_[col]*sqrt(sizeA/orbits_[sector[b]].size);
+			sparseRow.add(b,row.getValue(t)*characters[element_[col]]*factor);
+		}
+	}
+
+	PsimagLite::ProgressIndicator progress_;
+	const BasisType& basis_;
+	VectorGeneratorType generators_;
+	SizeType elements_;
+	SizeType denominator_;
+	VectorOrbitType orbits_;
+	VectorImageType stabilizer_;
+	VectorSizeType orbitOf_;
+	VectorSizeType element_;
+	PsimagLite::Vector<int>::Type sign_;
+	VectorSizeType blockSizes_;
+	typename PsimagLite::Vector<SparseMatrixType>::Type matrixStored_;
+	typename PsimagLite::Vector<VectorSizeType>::Type sectors_;
+	typename PsimagLite::Vector<VectorType>::Type characters_;
+	SizeType pointer_;
+	bool printMatrix_;
+	mutable DiagonalCacheType diagonalCache_;
+}; // class SymmetryGroup
+} // namespace LanczosPlusPlus
+
+#endif  // SYMMETRY_GROUP_H
@@ -19,151 +19,170 @@ Please see full open source license included in file LICENSE.
 #ifndef TRANSLATION_SYMM_H
 #define TRANSLATION_SYMM_H
 #include <iostream>
+#include <algorithm>
 #include "ProgressIndicator.h"
 #include "CrsMatrix.h"
 #include "Vector.h"
-#include "SparseVector.h"
+#include "SparseRow.h"
+#include "BitManip.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "DiagonalCache.h"
+#include "ParallelHamiltonianSetup.h"
+#include "SectorExpansion.h"
 
 namespace LanczosPlusPlus {
 
-struct TranslationItem {
-	SizeType type;
-	SizeType i;
-};
-
-template<typename RealType>
-class Kspace {
-
-public:
-
-	Kspace(SizeType len) : data_(len,len),blockSizes_(len,0)
-	{
-
-		for (SizeType i=0;i<len-1;i++) {
-			data_(i,i+1) = 1;
-		}
-		data_(len-1,0) =1;
-		typename PsimagLite::Vector<RealType>::Type e(len);
-		diag(data_,e,'V');
-	}
+// States reached from representative by repeated translation.
+// sign is the fermion sign picked up when the orbit closes
+struct TranslationOrbit {
 
-	SizeType size() const { return data_.n_row(); }
+	TranslationOrbit(SizeType representative_,SizeType period_,int sign_)
+	    : representative(representative_),period(period_),sign(sign_)
+	{}
 
-	const RealType& operator()(SizeType i,SizeType j) const
-	{
-		return data_(i,j);
-	}
-
-	void setBlockSize(SizeType k,SizeType s)
-	{
-		std::cout<<"BLOCKSZIZE["<<k<<"]="<<s<<"\n";
-		blockSizes_[k]=s;
-	}
-
-	SizeType blockSizes(SizeType k) const
-	{
-		return blockSizes_[k];
-	}
-
-	SizeType blockSize() const
-	{
-		SizeType sum = 0;
-		for (SizeType i=0;i<blockSizes_.size();i++)
-			sum += blockSizes_[i];
-		return sum;
-	}
-
-private:
-
-	PsimagLite::Matrix<RealType> data_;
-	PsimagLite::Vector<SizeType>::Type blockSizes_;
+	SizeType representative;
+	SizeType period;
+	int sign;
 };
 
-template<typename GeometryType,typename BasisType,typename KspaceType>
+template<typename GeometryType,typename BasisType>
 class ClassRepresentatives {
 
 	typedef typename BasisType::WordType WordType;
-	typedef TranslationItem ItemType;
+	typedef typename PsimagLite::Vector<WordType>::Type VectorWordType;
+
+	static int const FERMION_SIGN = -1;
 
 public:
 
-	ClassRepresentatives(const BasisType& basis,
-	                     const GeometryType& geometry,
-	                     const KspaceType& kspace)
-	    : basis_(basis),geometry_(geometry),data_(basis.size())
+	typedef TranslationOrbit OrbitType;
+
+	// Walks each orbit once, so setup is O(hilbert*length); the orbit,
+	// shift and sign of each state are kept, so that representative()
+	// is a lookup in the products
+	ClassRepresentatives(const BasisType& basis,const GeometryType& geometry)
+	    : basis_(basis),
+	      length_(geometry.length(1,0)),
+	      siteMap_(geometry.numberOfSites()),
+	      orbitOf_(basis.size()),
+	      shift_(basis.size()),
+	      sign_(basis.size())
 	{
+		SizeType diry = 1;
+		SizeType termId = 0;
+		for (SizeType site=0;site<siteMap_.size();site++)
+			siteMap_[site] = geometry.translate(site,diry,1,termId);
+
 		SizeType hilbert = basis.size();
 		PsimagLite::Vector<bool>::Type seen(hilbert,false);
-
+		PsimagLite::Vector<SizeType>::Type states;
+		PsimagLite::Vector<int>::Type signs;
 		for (SizeType ispace=0;ispace<hilbert;ispace++) {
+			if (seen[ispace]) continue;
+
+			// first unseen state is the smallest of its orbit;
+			// T^r|rep> = signs[r]|states[r]>
+			seen[ispace] = true;
+			states.clear();
+			signs.clear();
+			states.push_back(ispace);
+			signs.push_back(1);
+			int sign = 1;
+			SizeType state = translate(ispace,sign);
+			while (state != ispace) {
+				if (states.size() >= length_)
+					throw PsimagLite::RuntimeError("ClassRepresentatives: open orbit\n");
+				seen[state] = true;
+				states.push_back(state);
+				signs.push_back(sign);
+				state = translate(state,sign);
+			}
 
-			for (SizeType k=0;k<kspace.size();k++) {
-				typename PsimagLite::Vector<WordType>::Type y = translateInternal(ispace,k);
-				SizeType yIndex = basis.perfectIndex(y);
-				if (!seen[yIndex]) {
-					seen[yIndex]=true;
-					data_[yIndex].type = k;
-					data_[yIndex].i = ispace;
-				}
+			// T^(period-r)|states[r]> = signs[r] sign|rep>
+			SizeType period = states.size();
+			for (SizeType r=0;r<period;r++) {
+				orbitOf_[states[r]] = data_.size();
+				shift_[states[r]] = (r == 0) ? 0 : period - r;
+				sign_[states[r]] = (r == 0) ? 1 : signs[r]*sign;
 			}
+
+			data_.push_back(OrbitType(ispace,period,sign));
 		}
 	}
 
-	SizeType translate(SizeType state,SizeType k) const
-	{
-		for (SizeType i=0;i<data_.size();i++) {
-			if (data_[i].i == state && data_[i].type == k) return i;
-		}
+	SizeType size() const { return data_.size(); }
 
-		return state;
+	const OrbitType& operator()(SizeType i) const
+	{
+		assert(i < data_.size());
+		return data_[i];
 	}
 
-private:
+	SizeType length() const { return length_; }
 
-	typename PsimagLite::Vector<WordType>::Type translateInternal(SizeType state,
-	                                                              SizeType k) const
+	// T^period|rep> = sign|rep>, so momentum k survives the sum over
+	// the orbit only if exp(2 pi i k period/length)*sign = 1
+	bool hasMomentum(const OrbitType& orbit,SizeType k) const
+	{
+		SizeType x = (2*k*orbit.period) % (2*length_);
+		return (orbit.sign > 0) ? (x == 0) : (x == length_);
+	}
+
+	// Index of T|state>; sign is multiplied by the fermion sign
+	SizeType translate(SizeType state,int& sign) const
 	{
 		SizeType numberOfDofs = basis_.dofs();
-		typename PsimagLite::Vector<WordType>::Type y(numberOfDofs);
+		VectorWordType y(numberOfDofs,0);
 
-		for (SizeType dof=0;dof<numberOfDofs;dof++) {
-			WordType x = basis_(state,dof);
-			y[dof] = translateInternal2(x,k);
-		}
-		std::cout<<"translation of "<<basis_(state,0)<<" "<<basis_(state,1);
-		std::cout<<"is "<<y[0]<<" "<<y[1]<<"\n";
-		return y;
+		for (SizeType dof=0;dof<numberOfDofs;dof++)
+			y[dof] = translateWord(basis_(state,dof),sign);
+
+		return basis_.perfectIndex(y);
 	}
 
-	WordType translateInternal2(WordType state,SizeType k) const
+	// Smallest index in the orbit of state; on return
+	// T^shift|state> = sign|representative>
+	SizeType representative(SizeType state,SizeType& shift,int& sign) const
+	{
+		assert(state < orbitOf_.size());
+		shift = shift_[state];
+		sign = sign_[state];
+		return data_[orbitOf_[state]].representative;
+	}
+
+	const BasisType& basis() const { return basis_; }
+
+private:
+
+	// Moves each electron to its translated site; the sign is the
+	// parity of the reordering of the occupied sites
+	WordType translateWord(WordType x,int& sign) const
 	{
-		SizeType numberOfSites = geometry_.numberOfSites();
-		SizeType termId = 0;
-		WordType x = state;
 		WordType y = 0;
-		SizeType diry = 1;
-		for (SizeType site=0;site<numberOfSites;site++) {
-			SizeType tSite = geometry_.translate(site,diry,k,termId);
-			SizeType thisSiteContent = x & 1;
-			x >>=1; // go to next site
-			addTo(y,thisSiteContent,tSite);
+		SizeType inversions = 0;
+		for (SizeType site=0;site<siteMap_.size();site++) {
 			if (!x) break;
+			SizeType thisSiteContent = x & 1;
+			x >>= 1;
+			if (thisSiteContent == 0) continue;
+			SizeType tSite = siteMap_[site];
+			inversions += PsimagLite::BitManip::count(y >> tSite);
+			y |= (WordType(1) << tSite);
 		}
 
+		if (inversions & 1) sign *= FERMION_SIGN;
 		return y;
 	}
 
-	void addTo(WordType& yy,SizeType what,SizeType site) const
-	{
-		if (what==0) return;
-		WordType mask = (1<<site);
-		yy |= mask;
-	}
-
 	const BasisType& basis_;
-	const GeometryType& geometry_;
-	PsimagLite::Vector<TranslationItem>::Type data_;
-};
+	SizeType length_;
+	PsimagLite::Vector<SizeType>::Type siteMap_;
+	PsimagLite::Vector<SizeType>::Type orbitOf_;
+	PsimagLite::Vector<SizeType>::Type shift_;
+	PsimagLite::Vector<int>::Type sign_;
+	PsimagLite::Vector<OrbitType>::Type data_;
+}; // class ClassRepresentatives
 
 template<typename GeometryType_,typename BasisType>
 class TranslationSymmetry  {
@@ -172,11 +191,57 @@ class TranslationSymmetry  {
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
 	typedef ProgramGlobals::WordType WordType;
-	typedef PsimagLite::SparseVector<ComplexOrRealType> SparseVectorType;
-	typedef Kspace<RealType> KspaceType;
-	typedef ClassRepresentatives<GeometryType_,BasisType,KspaceType> ClassRepresentativesType;
-	typedef std::pair<PsimagLite::Vector<SizeType>::Type ,SizeType> BufferItemType;
-	typedef typename PsimagLite::Vector<SparseVectorType>::Type VectorSparseVectorType;
+	typedef ClassRepresentatives<GeometryType_,BasisType> ClassRepresentativesType;
+	typedef typename ClassRepresentativesType::OrbitType OrbitType;
+	typedef typename PsimagLite::Vector<OrbitType>::Type VectorOrbitType;
+	typedef std::pair<SizeType,ComplexOrRealType> ColValueType;
+	typedef typename PsimagLite::Vector<ColValueType>::Type VectorColValueType;
+	typedef DiagonalCache<RealType,BasisType> DiagonalCacheType;
+	typedef PsimagLite::Concurrency ConcurrencyType;
+
+	// x += H_k y in sector k, one row at a time
+	template<typename SomeModelType,typename SomeVectorType>
+	class SectorProductHelper {
+
+		typedef typename SomeModelType::SparseMatrixType ModelSparseMatrixType;
+		typedef typename PsimagLite::Vector<RealType>::Type VectorDiagType;
+		typedef PsimagLite::SparseRow<ModelSparseMatrixType> SparseRowType;
+
+	public:
+
+		SectorProductHelper(SomeVectorType& x,
+		                    const SomeVectorType& y,
+		                    const TranslationSymmetry& symm,
+		                    const SomeModelType& model,
+		                    const VectorDiagType& diag,
+		                    SizeType k)
+		    : x_(x),y_(y),symm_(symm),model_(model),diag_(diag),k_(k)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      ConcurrencyType::MutexType*)
+		{
+			ModelSparseMatrixType row;
+			SparseRowType sparseRow;
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType a = threadNum*blockSize + p;
+				if (a>=total) break;
+				symm_.setSectorRow(sparseRow,row,model_,k_,a,diag_);
+				x_[a] += sparseRow.finalize(y_);
+			}
+		}
+
+	private:
+
+		SomeVectorType& x_;
+		const SomeVectorType& y_;
+		const TranslationSymmetry& symm_;
+		const SomeModelType& model_;
+		const VectorDiagType& diag_;
+		SizeType k_;
+	}; // class SectorProductHelper
 
 public:
 
@@ -185,51 +250,79 @@ public:
 	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
 
+	// Sector k is spanned by the normalized Bloch sums
+	// sum_r exp(-2 pi i k r/length) T^r|rep> over orbits with momentum k,
+	// so that T^shift|ispace> = sign|rep> gives <ispace|b> = exp(i k shift) sign
 	TranslationSymmetry(const BasisType& basis,
 	                    const GeometryType& geometry,
 	                    PsimagLite::String options)
 	    : progress_("TranslationSymmetry"),
-	      transform_(basis.size(),basis.size()),
-	      kspace_(geometry.length(1,0)),
-	      matrixStored_(kspace_.size()),
+	      reps_(basis,geometry),
+	      blockSizes_(reps_.length(),0),
+	      sectors_(reps_.length()),
 	      pointer_(0),
 	      printMatrix_(options.find("printmatrix")!=PsimagLite::String::npos)
 	{
-		ClassRepresentativesType reps(basis,geometry,kspace_);
-
-		SizeType hilbert = basis.size();
-		VectorSparseVectorType bag;
-		for (SizeType k=0;k<kspace_.size();k++) {
-			SizeType blockSize = 0;
-			for (SizeType ispace=0;ispace<hilbert;ispace++) {
-				typename PsimagLite::Vector<ComplexOrRealType>::Type v(hilbert);
-				eikrTr(v,ispace,k,reps);
-				SparseVectorType sparseV(v);
-				sparseV.sort();
-				if (!checkForOrthogonality(sparseV,bag)) continue;
-				bag.push_back(sparseV);
-				blockSize++;
-			}
-			kspace_.setBlockSize(k,blockSize);
+		SizeType total = 0;
+		for (SizeType k=0;k<blockSizes_.size();k++) {
+			for (SizeType i=0;i<reps_.size();i++)
+				if (reps_.hasMomentum(reps_(i),k)) blockSizes_[k]++;
+			total += blockSizes_[k];
 		}
 
-		if (kspace_.blockSize()!=hilbert) {
-			std::cout<<"Blocksizes summed="<<kspace_.blockSize();
+		SizeType hilbert = basis.size();
+		if (total!=hilbert) {
+			std::cout<<"Blocksizes summed="<<total;
 			std::cout<<" but hilbert="<<hilbert<<"\n";
 			throw std::runtime_error("error!\n");
 		}
-		setTransform(bag);
-		//			checkTransform();
+
+		for (SizeType k=0;k<sectors_.size();k++)
+			fillSector(sectors_[k],k);
+
+		PsimagLite::OstringStream msg;
+		msg<<reps_.size()<<" orbits, block sizes";
+		for (SizeType k=0;k<blockSizes_.size();k++)
+			msg<<" "<<blockSizes_[k];
+		progress_.printline(msg,std::cout);
 	}
 
+	// Fills all blocks row by row; neither the full Hamiltonian nor
+	// the transform is stored. Each row is also compared with the row
+	// of its translated state, as couplings or potentials that break T
+	// would otherwise give wrong blocks
 	template<typename SomeModelType>
 	void init(const SomeModelType& model,const BasisType& basis)
 	{
-		SparseMatrixType matrix2;
-		model.setupHamiltonian(matrix2,basis);
-		transformMatrix(matrixStored_,matrix2);
+		if (&basis != &reps_.basis())
+			throw PsimagLite::RuntimeError("TranslationSymmetry: wrong basis\n");
+		typedef typename SomeModelType::SparseMatrixType ModelSparseMatrixType;
+		typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
+
+		const VectorRealType& diag = diagonalCache_(model,basis);
+		checkDiagonal(diag);
+		ModelSparseMatrixType row;
+		ModelSparseMatrixType partnerRow;
+		for (SizeType ispace=0;ispace<basis.size();ispace++)
+			checkRow(row,partnerRow,model,ispace,diag);
+
+		SparseRowType sparseRow;
+		matrixStored_.resize(sectors_.size());
+		for (SizeType k=0;k<sectors_.size();k++) {
+			SizeType rank = sectors_[k].size();
+			SparseMatrixType& m = matrixStored_[k];
+			m.resize(rank,rank);
+			SizeType counter = 0;
+			for (SizeType a=0;a<rank;a++) {
+				m.setRow(a,counter);
+				setSectorRow(sparseRow,row,model,k,a,diag);
+				counter += sparseRow.finalize(m);
+			}
+
+			m.setRow(rank,counter);
+			m.checkValidity();
+		}
 
-		if (matrixStored_.size() == 0) return;
 		int nrows = matrixStored_[0].row();
 		if (printMatrix_) {
 			if (nrows > 40)
@@ -238,49 +331,129 @@ public:
 		}
 	}
 
-	SizeType rank() const { return matrixStored_[pointer_].row(); }
+	SizeType rank() const { return rank(pointer_); }
+
+	SizeType rank(SizeType k) const { return matrixStored_[k].row(); }
 
 	template<typename SomeVectorType>
 	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
 	{
-		return matrixStored_[pointer_].matrixVectorProduct(x,y);
+		matrixVectorProduct(x,y,pointer_);
 	}
 
-	void transformMatrix(typename PsimagLite::Vector<SparseMatrixType>::Type& matrix1,
-	                     const SparseMatrixType& matrix) const
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y,SizeType k) const
 	{
-		SparseMatrixType rT;
-		transposeConjugate(rT,transform_);
+		return matrixStored_[k].matrixVectorProduct(x,y);
+	}
 
-		if (matrix.row()<40) printFullMatrix(matrix,"originalHam");
-		SparseMatrixType tmp;
-		multiply(tmp,matrix,rT);
+	// On the fly nothing Hilbert-sized is stored but the diagonal,
+	// computed here so that sectors can then be used from several threads
+	template<typename SomeModelType>
+	void initOnTheFly(const SomeModelType& model,const BasisType& basis)
+	{
+		if (&basis != &reps_.basis())
+			throw PsimagLite::RuntimeError("TranslationSymmetry: wrong basis\n");
+		checkDiagonal(diagonalCache_(model,basis));
+	}
 
-		SparseMatrixType matrix2;
-		multiply(matrix2,transform_,tmp);
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType&,const BasisType&) const
+	{
+		return sectors_[pointer_].size();
+	}
 
-		if (matrix2.row()<40)
-			printFullMatrix(matrix2,"HamiltonianTransformed");
-		matrix1.clear();
-		split(matrix1,matrix2);
+	template<typename SomeModelType>
+	SizeType rank(const SomeModelType&,const BasisType&,SizeType k) const
+	{
+		return sectors_[k].size();
 	}
 
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis) const
+	{
+		matrixVectorProduct(x,y,model,basis,pointer_,ConcurrencyType::npthreads);
+	}
+
+	template<typename SomeVectorType,typename SomeModelType>
+	void matrixVectorProduct(SomeVectorType &x,
+	                         SomeVectorType const &y,
+	                         const SomeModelType& model,
+	                         const BasisType& basis,
+	                         SizeType k,
+	                         SizeType threads) const
+	{
+		SizeType rank = sectors_[k].size();
+		assert(x.size() == rank && y.size() == rank);
+		typedef SectorProductHelper<SomeModelType,SomeVectorType> HelperType;
+		typedef PsimagLite::Parallelizer<HelperType> ParallelizerType;
+		HelperType helper(x,y,*this,model,diagonalCache_(model,basis,threads),k);
+		ParallelizerType threadObject(threads,PsimagLite::MPI::COMM_WORLD);
+		threadObject.loopCreate(rank,helper);
+	}
+
+	// gs is in the sector that starts at offset
 	void transformGs(VectorType& gs,SizeType offset)
 	{
-		VectorType gstmp(transform_.row(),0);
+		SizeType k = 0;
+		SizeType start = 0;
+		for (;k<blockSizes_.size();k++) {
+			if (start == offset && blockSizes_[k] > 0) break;
+			start += blockSizes_[k];
+		}
+
+		if (k == blockSizes_.size() || blockSizes_[k] != gs.size())
+			throw PsimagLite::RuntimeError("TranslationSymmetry: wrong offset\n");
+
+		VectorType gstmp;
+		SectorExpansion<TranslationSymmetry>::expand(gstmp,gs,*this,k,reps_.basis().size());
+		gs.swap(gstmp);
+	}
+
+	// Component ispace of the real-space form of v, of momentum k: with
+	// T^shift|ispace> = sign|rep_b>, <ispace|b> = exp(i k shift) sign/sqrt(period_b)
+	ComplexOrRealType realSpaceComponent(const VectorType& v,
+	                                     SizeType k,
+	                                     SizeType ispace) const
+	{
+		SizeType shift = 0;
+		int sign = 1;
+		SizeType rep = reps_.representative(ispace,shift,sign);
+		const VectorOrbitType& sector = sectors_[k];
+		SizeType b = findInSector(sector,rep);
+		if (b >= sector.size()) return 0.0;
+		RealType kFactor = 2*M_PI*k/RealType(reps_.length());
+		RealType factor = sign/sqrt(static_cast<RealType>(sector[b].period));
+		return eikr(kFactor*shift)*factor*v[b];
+	}
 
-		for (SizeType i=0;i<gs.size();i++) {
-			assert(i+offset<gstmp.size());
-			gstmp[i+offset]=gs[i];
+	// Components of the real-space vector src in momentum k
+	void transformToSector(VectorType& dest,const VectorType& src,SizeType k) const
+	{
+		const VectorOrbitType& sector = sectors_[k];
+		dest.resize(sector.size());
+		VectorColValueType buffer;
+		for (SizeType a=0;a<sector.size();a++) {
+			fillBlochSum(buffer,sector[a],k);
+			dest[a] = 0.0;
+			for (SizeType j=0;j<buffer.size();j++)
+				dest[a] += buffer[j].second*src[buffer[j].first];
 		}
-		SparseMatrixType rT;
-		transposeConjugate(rT,transform_);
-		gs.clear();
-		gs.resize(transform_.row());
-		multiply(gs,rT,gstmp);
 	}
 
-	SizeType sectors() const { return kspace_.size(); }
+	SizeType sectors() const { return blockSizes_.size(); }
+
+	// Stored elements, for the memory estimate of the sector cache
+	SizeType nonZeros() const
+	{
+		SizeType sum = 0;
+		for (SizeType i=0;i<matrixStored_.size();i++)
+			sum += matrixStored_[i].nonZeros();
+		return sum;
+	}
 
 	void setPointer(SizeType p) { pointer_=p; }
 
@@ -303,105 +476,169 @@ public:
 
 private:
 
-	void addTo(WordType& yy,SizeType what,SizeType site) const
+	void throwNoSymmetry(PsimagLite::String what) const
+	{
+		PsimagLite::String s(__FILE__);
+		s += " Hamiltonian has no translation symmetry:" + what;
+		throw std::runtime_error(s.c_str());
+	}
+
+	// A potentialV that is not uniform shows up here
+	void checkDiagonal(const VectorRealType& diag) const
 	{
-		if (what==0) return;
-		WordType mask = (1<<site);
-		yy |= mask;
+		for (SizeType ispace=0;ispace<diag.size();ispace++) {
+			int sign = 1;
+			if (fabs(diag[ispace] - diag[reps_.translate(ispace,sign)]) > 1e-10)
+				throwNoSymmetry(" diagonal differs.");
+		}
 	}
 
-	void setTransform(const VectorSparseVectorType& bag)
+	// H(i,c) == sign_i sign_c H(T(i),T(c)) for all c, from T H T^dagger = H
+	template<typename SomeModelType>
+	void checkRow(typename SomeModelType::SparseMatrixType& row,
+	              typename SomeModelType::SparseMatrixType& partnerRow,
+	              const SomeModelType& model,
+	              SizeType ispace,
+	              const VectorRealType& diag) const
 	{
-		SizeType counter = 0;
-		for (SizeType row=0;row<bag.size();row++) {
-			transform_.setRow(row,counter);
-			for (SizeType k=0;k<bag[row].indices();k++) {
-				transform_.pushCol(bag[row].index(k));
-				transform_.pushValue(bag[row].value(k));
-				counter++;
+		typedef ParallelHamiltonianSetup<SomeModelType> SetupType;
+		int signI = 1;
+		SizeType jspace = reps_.translate(ispace,signI);
+		SizeType n = SetupType::setupRow(row,model,ispace,diag,reps_.basis());
+		SizeType m = SetupType::setupRow(partnerRow,model,jspace,diag,reps_.basis());
+		if (nonZeros(row,n) != nonZeros(partnerRow,m))
+			throwNoSymmetry(" hoppings differ.");
+
+		for (SizeType t=0;t<n;t++) {
+			int sign = signI;
+			SizeType col = reps_.translate(row.getCol(t),sign);
+			ComplexOrRealType val = 0.0;
+			for (SizeType u=0;u<m;u++) {
+				if (SizeType(partnerRow.getCol(u)) != col) continue;
+				val = partnerRow.getValue(u);
+				break;
 			}
+
+			if (PsimagLite::norm(row.getValue(t) - RealType(sign)*val) > 1e-12)
+				throwNoSymmetry(" hoppings differ.");
 		}
+	}
 
-		transform_.setRow(transform_.row(),counter);
-		transform_.checkValidity();
-		if (transform_.row()<40)
-			printFullMatrix(transform_,"transform");
+	template<typename SomeSparseMatrixType>
+	static SizeType nonZeros(const SomeSparseMatrixType& row,SizeType n)
+	{
+		SizeType c = 0;
+		for (SizeType t=0;t<n;t++)
+			if (PsimagLite::norm(row.getValue(t)) > 1e-12) c++;
+		return c;
 	}
 
-	void eikrTr(typename PsimagLite::Vector<std::complex<RealType> >::Type& v,
-	            SizeType ispace,
-	            SizeType k,
-	            const ClassRepresentativesType& reps) const
+	static bool lessByColumn(const ColValueType& a,const ColValueType& b)
 	{
-		for (SizeType r=0;r<kspace_.size();r++) {
-			SizeType jspace = reps.translate(ispace,r);
-			RealType tmp = 2*M_PI*k*r/RealType(kspace_.size());
-			v[jspace] = ComplexOrRealType(cos(tmp),sin(tmp));
-		}
+		return (a.first < b.first);
+	}
+
+	static bool lessByRepresentative(const OrbitType& orbit,SizeType rep)
+	{
+		return (orbit.representative < rep);
+	}
+
+	// Orbits with momentum k, by increasing representative
+	void fillSector(VectorOrbitType& sector,SizeType k) const
+	{
+		sector.clear();
+		sector.reserve(blockSizes_[k]);
+		for (SizeType i=0;i<reps_.size();i++)
+			if (reps_.hasMomentum(reps_(i),k)) sector.push_back(reps_(i));
 	}
 
-	void eikrTr(typename PsimagLite::Vector<RealType>::Type&,
-	            SizeType,
-	            SizeType,
-	            const ClassRepresentativesType&) const
+	// Position of rep in sector, or sector.size() if not there
+	SizeType findInSector(const VectorOrbitType& sector,SizeType rep) const
 	{
-		throw PsimagLite::RuntimeError("eikrTr: not for real template\n");
+		typename VectorOrbitType::const_iterator it = std::lower_bound(sector.begin(),
+		                                                               sector.end(),
+		                                                               rep,
+		                                                               lessByRepresentative);
+		if (it == sector.end() || it->representative != rep) return sector.size();
+		return it - sector.begin();
 	}
 
-	bool checkForOrthogonality(const SparseVectorType& sparseV,
-	                           const VectorSparseVectorType& bag) const
+	// Row a of sector k, from the real-space row of its representative.
+	// T commutes with H, so <a|H|b> = sqrt(period_a) <rep_a|H|b>; a
+	// column c with T^shift|c> = sign|rep_b> has
+	// <c|b> = exp(i k shift) sign/sqrt(period_b)
+	template<typename SomeModelType,typename SparseRowType>
+	void setSectorRow(SparseRowType& sparseRow,
+	                  typename SomeModelType::SparseMatrixType& row,
+	                  const SomeModelType& model,
+	                  SizeType k,
+	                  SizeType a,
+	                  const VectorRealType& diag) const
 	{
-		for (SizeType i=0;i<bag.size();i++) {
-			ComplexOrRealType sp = sparseV.scalarProduct(bag[i]);
-			if (PsimagLite::norm(sp)>1e-8) return false;
+		const VectorOrbitType& sector = sectors_[k];
+		const OrbitType& orbitA = sector[a];
+		SizeType n = ParallelHamiltonianSetup<SomeModelType>::setupRow(row,
+		                                                               model,
+		                                                               orbitA.representative,
+		                                                               diag,
+		                                                               reps_.basis());
+		RealType kFactor = 2*M_PI*k/RealType(reps_.length());
+		for (SizeType t=0;t<n;t++) {
+			SizeType shift = 0;
+			int sign = 1;
+			SizeType rep = reps_.representative(row.getCol(t),shift,sign);
+			SizeType b = findInSector(sector,rep);
+			if (b >= sector.size()) continue;
+			RealType factor = sign*sqrt(orbitA.period/
+			                            static_cast<RealType>(sector[b].period));
+			sparseRow.add(b,row.getValue(t)*eikr(kFactor*shift)*factor);
 		}
-		return true;
 	}
 
-	void split(typename PsimagLite::Vector<SparseMatrixType>::Type& matrix,
-	           const SparseMatrixType& matrix2) const
+	// Overlaps <b|T^r rep> = exp(2 pi i k r/length) sign_r/sqrt(period) of
+	// the Bloch sum b of orbit, the conjugates of its coefficients, sorted by column
+	void fillBlochSum(VectorColValueType& buffer,
+	                  const OrbitType& orbit,
+	                  SizeType k) const
 	{
-		SizeType offset = 0;
-		for (SizeType i=0;i<kspace_.size();i++) {
-			SizeType blockSize = kspace_.blockSizes(i);
-			if (blockSize==0) continue;
-			std::cout<<"BLOCKSIZE="<<blockSize<<"\n";
-			SparseMatrixType m(blockSize,blockSize);
-			SizeType counter = 0;
-			for (SizeType row=0;row<blockSize;row++) {
-				m.setRow(row,counter);
-				SizeType globalRow = row + offset;
-				SizeType start = matrix2.getRowPtr(globalRow);
-				SizeType end = matrix2.getRowPtr(globalRow+1);
-				for (SizeType k=start;k<end;k++) {
-					ComplexOrRealType val = matrix2.getValue(k);
-					if (PsimagLite::norm(val)<1e-8) continue;
-					SizeType globalCol = matrix2.getCol(k);
-
-					assert(globalCol>=offset);
-					SizeType col = globalCol - offset;
-
-					assert(col<blockSize);
-					m.pushCol(col);
-					m.pushValue(val);
-					counter++;
-				}
-			}
-			m.setRow(blockSize,counter);
-			m.checkValidity();
-			matrix.push_back(m);
-			offset += blockSize;
+		buffer.clear();
+		RealType norm = 1.0/sqrt(static_cast<RealType>(orbit.period));
+		SizeType state = orbit.representative;
+		int sign = 1;
+		for (SizeType r=0;r<orbit.period;r++) {
+			RealType tmp = 2*M_PI*k*r/RealType(reps_.length());
+			buffer.push_back(ColValueType(state,eikr(tmp)*(sign*norm)));
+			state = reps_.translate(state,sign);
 		}
+
+		std::sort(buffer.begin(),buffer.end(),lessByColumn);
+	}
+
+	ComplexOrRealType eikr(RealType tmp) const
+	{
+		return eikr(tmp,ComplexOrRealType());
+	}
+
+	std::complex<RealType> eikr(RealType tmp,const std::complex<RealType>&) const
+	{
+		return std::complex<RealType>(cos(tmp),sin(tmp));
+	}
+
+	RealType eikr(RealType,const RealType&) const
+	{
+		throw PsimagLite::RuntimeError("eikr: not for real template\n");
 	}
 
 	PsimagLite::ProgressIndicator progress_;
-	SparseMatrixType transform_;
-	KspaceType kspace_;
+	ClassRepresentativesType reps_;
+	PsimagLite::Vector<SizeType>::Type blockSizes_;
 	typename PsimagLite::Vector<SparseMatrixType>::Type matrixStored_;
+	typename PsimagLite::Vector<VectorOrbitType>::Type sectors_;
 	SizeType pointer_;
 	bool printMatrix_;
+	mutable DiagonalCacheType diagonalCache_;
 }; // class TranslationSymmetry
-} // namespace Dmrg
+} // namespace LanczosPlusPlus
 
 #endif  // TRANSLATION_SYMM_H
 
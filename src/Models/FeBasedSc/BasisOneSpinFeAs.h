@@ -60,12 +60,18 @@ public:
 			data_.resize(1);
 			size_ =1;
 			data_[0]=0;
+			partitionOffset_.resize(1,0);
 			return;
 		}
 		size_ = 0;
 		PartitionsType partitions(npart,orbitals_);
+		SizeType keys = 1;
+		for (SizeType orb=0; orb+1<orbitals_; orb++)
+			keys *= (npart_+1);
+		partitionOffset_.resize(keys,0);
 		for (SizeType i=0; i<partitions.size(); i++) {
 			const PsimagLite::Vector<SizeType>::Type& na = partitions(i);
+			partitionOffset_[partitionKey(na)] = size_;
 			SizeType tmp = 1;
 			for (SizeType j=0; j<na.size(); j++)
 				tmp *= comb_(nsite_,na[j]);
@@ -96,11 +102,35 @@ public:
 		return data_[i];
 	}
 
+	// Blocks of data_ follow Partitions order; inside a block the index is
+	// i0 + i1*s0 + i2*s0*s1 + ..., with i_orb the rank of the ket of orbital orb
+	// and s_orb = C(nsite,n_orb) (see collateBasis and getKets)
 	SizeType perfectIndex(WordType ket) const
 	{
-		for (SizeType i=0; i<data_.size(); i++)
-			if (data_[i]==ket) return i;
-		throw std::runtime_error("perfectindex\n");
+		SizeType index = 0;
+		SizeType sizes = 1;
+		SizeType key = 0;
+		SizeType radix = 1;
+		for (SizeType orb=0; orb<orbitals_; orb++) {
+			WordType ketOrb = 0;
+			for (SizeType site=0; site<nsite_; site++)
+				if (ket & bitmask_[site*orbitals_+orb]) ketOrb |= bitmask_[site];
+
+			SizeType na = PsimagLite::BitManip::count(ketOrb);
+			if (na > npart_)
+				throw std::runtime_error("perfectindex\n");
+
+			index += perfectIndexPartial(ketOrb)*sizes;
+			sizes *= comb_(nsite_,na);
+			if (orb+1 == orbitals_) continue;
+			key += na*radix;
+			radix *= (npart_+1);
+		}
+
+		index += partitionOffset_[key];
+		if (index >= size_ || data_[index] != ket)
+			throw std::runtime_error("perfectindex\n");
+		return index;
 	}
 
 	SizeType getN(WordType ket,SizeType site,SizeType orb) const
@@ -365,6 +395,19 @@ private:
 			bitmask_[i] = bitmask_[i-1]<<1;
 	}
 
+	// n_orb of all orbitals but the last one, in base npart+1
+	SizeType partitionKey(const PsimagLite::Vector<SizeType>::Type& na) const
+	{
+		SizeType key = 0;
+		SizeType radix = 1;
+		for (SizeType orb=0; orb+1<na.size(); orb++) {
+			key += na[orb]*radix;
+			radix *= (npart_+1);
+		}
+
+		return key;
+	}
+
 	SizeType perfectIndexPartial(WordType state) const
 	{
 		SizeType n=0;
@@ -459,6 +502,7 @@ private:
 	SizeType size_;
 	SizeType npart_;
 	PsimagLite::Vector<WordType>::Type data_;
+	PsimagLite::Vector<SizeType>::Type partitionOffset_;
 
 }; // class BasisOneSpinFeAs
 
@@ -26,7 +26,10 @@ Please see full open source license included in file LICENSE.
 #include "ParametersModelFeAs.h"
 #include "ModelBase.h"
 #include "Geometry/GeometryDca.h"
-#include "Parallelizer.h"
+#include "ParallelHamiltonianSetup.h"
+#include "ParallelMatrixVectorProduct.h"
+#include "DiagonalCache.h"
+#include "BondList.h"
 
 namespace LanczosPlusPlus {
 
@@ -38,85 +41,24 @@ class FeBasedSc : public ModelBase<ComplexOrRealType,GeometryType,InputType> {
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef ModelBase<ComplexOrRealType,GeometryType,InputType> BaseType;
 	typedef PsimagLite::GeometryDca<RealType,GeometryType> GeometryDcaType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	friend class ParallelHamiltonianSetup<ThisType>;
+	friend class ParallelMatrixVectorProduct<ThisType>;
 
 	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
 
 	typedef ParametersModelFeAs<RealType> ParametersModelType;
 	typedef BasisFeAsBasedSc<GeometryType> BasisType;
 	typedef typename BasisType::BaseType BasisBaseType;
+	typedef DiagonalCache<RealType,BasisBaseType> DiagonalCacheType;
 	typedef typename BasisType::WordType WordType;
+	typedef BondList<ComplexOrRealType,WordType> BondListType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
 	typedef typename BaseType::VectorType VectorType;
 
-	class MatrixVectorHelper {
-
-		typedef PsimagLite::Concurrency ConcurrencyType;
-
-	public:
-
-		MatrixVectorHelper(SizeType nthreads,
-		                   VectorType &x,
-		                   const VectorType& y,
-		                   const BasisBaseType& basis,
-		                   const ThisType& myself)
-		    : nthreads_(nthreads),x_(x),y_(y),basis_(basis),myself_(myself)
-		{}
-
-		void thread_function_(SizeType threadNum,
-		                      SizeType blockSize,
-		                      SizeType total,
-		                      ConcurrencyType::MutexType*)
-		{
-			SizeType nsite = myself_.geometry_.numberOfSites();
-			for (SizeType p=0;p<blockSize;p++) {
-				SizeType ispace = threadNum*blockSize + p;
-				if (ispace>=total) break;
-				SparseRowType sparseRow;
-
-				WordType ket1 = basis_.operator()(ispace,SPIN_UP);
-				WordType ket2 = basis_.operator()(ispace,SPIN_DOWN);
-
-				x_[ispace] += myself_.findS(nsite,ket1,ket2,ispace,basis_)*y_[ispace];
-
-				for (SizeType i=0;i<nsite;i++) {
-					for (SizeType orb=0;orb<myself_.mp_.orbitals;orb++) {
-						myself_.setHoppingTerm(sparseRow,ket1,ket2,
-						                       i,orb,basis_);
-
-						if (myself_.mp_.feAsMode == 0) {
-							myself_.setU2OffDiagonalTerm(sparseRow,ket1,ket2,
-							                             i,orb,basis_);
-
-							for (SizeType orb2=orb+1;orb2<myself_.mp_.orbitals;orb2++) {
-								myself_.setU3Term(sparseRow,ket1,ket2,
-								                  i,orb,orb2,basis_);
-							}
-
-							myself_.setJTermOffDiagonal(sparseRow,ket1,ket2,
-							                            i,orb,basis_);
-						} else if (myself_.mp_.feAsMode == 1 || myself_.mp_.feAsMode == 2) {
-							myself_.setOffDiagonalDecay(sparseRow,ket1,ket2,
-							                            i,orb,basis_);
-						} else if (myself_.mp_.feAsMode == 3) {
-							myself_.setOffDiagonalJimpurity(sparseRow,ket1,ket2,i,orb,basis_);
-						} else if (myself_.mp_.feAsMode == 4) {
-							myself_.setOffDiagonalKspace(sparseRow,ket1,ket2,i,orb,basis_);
-						}
-					}
-				}
-
-				x_[ispace] += sparseRow.finalize(y_);
-			}
-		}
-
-	private:
+	friend class DiagonalCache<RealType,BasisBaseType>;
 
-		SizeType nthreads_;
-		VectorType &x_;
-		const VectorType& y_;
-		const BasisBaseType& basis_;
-		const ThisType& myself_;
-	}; // class MatrixVectorHelper
 
 public:
 
@@ -129,11 +71,34 @@ public:
 	      geometry_(geometry),
 	      basis_(geometry,nup,ndown,mp_.orbitals),
 	      geometryDca_(geometry,mp_.orbitals)
-	{}
-
-	~FeBasedSc()
 	{
-		BaseType::deleteGarbage(garbage_);
+		SizeType nsite = geometry_.numberOfSites();
+		SizeType orbitals = mp_.orbitals;
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb=0;orb<orbitals;orb++) {
+				SizeType ii = i*orbitals+orb;
+				for (SizeType j=i;j<nsite;j++) {
+					for (SizeType orb2=0;orb2<orbitals;orb2++) {
+						SizeType jj = j*orbitals+orb2;
+						WordType mask = BasisType::bitmask(ii) | BasisType::bitmask(jj);
+						hoppingBonds_.push(j,orb2,mask,hoppings(i,orb,j,orb2));
+					}
+				}
+
+				hoppingBonds_.closeOrigin();
+			}
+
+			// by site; orbitals are looped over by the callers
+			for (SizeType j=0;j<nsite;j++) {
+				if (TERM_J_PM < geometry_.terms())
+					jPmBonds_.push(j,0,0,jCoupling(i,j,TERM_J_PM));
+				if (TERM_J_ZZ < geometry_.terms())
+					jZzBonds_.push(j,0,0,jCoupling(i,j,TERM_J_ZZ));
+			}
+
+			jPmBonds_.closeOrigin();
+			jZzBonds_.closeOrigin();
+		}
 	}
 
 	SizeType size() const { return basis_.size(); }
@@ -161,100 +126,107 @@ public:
 	void setupHamiltonian(SparseMatrixType& matrix,
 	                      const BasisBaseType& basis) const
 	{
-		// Calculate diagonal elements AND count non-zero matrix elements
 		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert);
+		VectorRealType diag(hilbert);
 		calcDiagonalElements(diag,basis);
 
-		SizeType nsite = geometry_.numberOfSites();
-
-		// Setup CRS matrix
-		matrix.resize(hilbert,hilbert);
-
-		// Calculate off-diagonal elements AND store matrix
-		SizeType nCounter=0;
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			SparseRowType sparseRow;
-			matrix.setRow(ispace,nCounter);
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			// Save diagonal
-			sparseRow.add(ispace,diag[ispace]);
-			for (SizeType i=0;i<nsite;i++) {
-				for (SizeType orb=0;orb<mp_.orbitals;orb++) {
-					setHoppingTerm(sparseRow,ket1,ket2,i,orb,basis);
-
-					if (mp_.feAsMode == 0) {
-						setU2OffDiagonalTerm(sparseRow,ket1,ket2,
-						                     i,orb,basis);
-						for (SizeType orb2=0;orb2<mp_.orbitals;orb2++) {
-							if (orb==orb2) continue;
-
-							setU3Term(sparseRow,ket1,ket2,
-							          i,orb,orb2,basis);
-						}
-
-						setJTermOffDiagonal(sparseRow,ket1,ket2,
-						                    i,orb,basis);
-
-						setSpinOrbitOffDiagonal(sparseRow,ket1,ket2,
-						                    i,orb,basis);
-
-					} else if (mp_.feAsMode == 1 || mp_.feAsMode == 2) {
-						setOffDiagonalDecay(sparseRow,ket1,ket2,
-						                    i,orb,basis);
-					} else if (mp_.feAsMode == 3) {
-						setOffDiagonalJimpurity(sparseRow,ket1,ket2,i,orb,basis);
-					} else if (mp_.feAsMode == 4) {
-						setOffDiagonalKspace(sparseRow,ket1,ket2,i,orb,basis);
-					}
-				}
-			}
-
-			nCounter += sparseRow.finalize(matrix);
-		}
-
-		matrix.setRow(hilbert,nCounter);
+		ParallelHamiltonianSetup<ThisType> parallelSetup(*this,diag,basis);
+		parallelSetup(matrix);
 	}
 
 	void matrixVectorProduct(VectorType &x,const VectorType& y) const
 	{
-		matrixVectorProduct(x,y,basis_);
+		matrixVectorProduct(x,y,basis_,PsimagLite::Concurrency::npthreads);
 	}
 
 	void matrixVectorProduct(VectorType &x,
 	                         const VectorType& y,
-	                         const BasisBaseType& basis) const
+	                         const BasisBaseType& basis,
+	                         SizeType threads) const
 	{
-		SizeType hilbert=basis.size();
-
-		// Calculate off-diagonal elements AND store matrix
-		typedef MatrixVectorHelper HelperType;
-		typedef PsimagLite::Parallelizer<HelperType> ParallelizerType;
-		ParallelizerType threadObject(PsimagLite::Concurrency::npthreads,
-		                              PsimagLite::MPI::COMM_WORLD);
-		HelperType helper(PsimagLite::Concurrency::npthreads,x,y,basis,*this);
-
-		std::cout<<"Using "<<threadObject.name();
-		std::cout<<" with "<<threadObject.threads()<<" threads.\n";
-		threadObject.loopCreate(hilbert,helper);
+		const VectorRealType& diag = diagonalCache_(*this,basis,threads);
+		ParallelMatrixVectorProduct<ThisType> parallelProduct(*this,diag,basis,threads);
+		parallelProduct(x,y);
 	}
 
 	const BasisType& basis() const { return basis_; }
 
 	PsimagLite::String name() const { return __FILE__; }
 
-	BasisType* createBasis(SizeType nup, SizeType ndown) const
+	BasisType* newBasis(SizeType nup, SizeType ndown) const
 	{
-		BasisType* ptr = new BasisType(geometry_,nup,ndown);
-		garbage_.push_back(ptr);
-		return ptr;
+		return new BasisType(geometry_,nup,ndown);
 	}
 
 	void print(std::ostream& os) const { os<<mp_; }
 
 private:
 
+	// Pushes row ispace of the Hamiltonian into matrix, returns its nonzeros
+	SizeType setupRow(SparseMatrixType& matrix,
+	                  SizeType ispace,
+	                  const VectorRealType& diag,
+	                  const BasisBaseType& basis) const
+	{
+		SparseRowType sparseRow;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		// Save diagonal
+		sparseRow.add(ispace,diag[ispace]);
+		setOffDiagonalTerms(sparseRow,ket1,ket2,basis);
+		return sparseRow.finalize(matrix);
+	}
+
+	// Off-diagonal part of row ispace times y
+	ComplexOrRealType offDiagonalProduct(const VectorType& y,
+	                                     SizeType ispace,
+	                                     const BasisBaseType& basis) const
+	{
+		SparseRowType sparseRow;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		setOffDiagonalTerms(sparseRow,ket1,ket2,basis);
+		return sparseRow.finalize(y);
+	}
+
+	void setOffDiagonalTerms(SparseRowType& sparseRow,
+	                         const WordType& ket1,
+	                         const WordType& ket2,
+	                         const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb=0;orb<mp_.orbitals;orb++) {
+				setHoppingTerm(sparseRow,ket1,ket2,i,orb,basis);
+
+				if (mp_.feAsMode == 0) {
+					setU2OffDiagonalTerm(sparseRow,ket1,ket2,
+					                     i,orb,basis);
+					for (SizeType orb2=0;orb2<mp_.orbitals;orb2++) {
+						if (orb==orb2) continue;
+
+						setU3Term(sparseRow,ket1,ket2,
+						          i,orb,orb2,basis);
+					}
+
+					setJTermOffDiagonal(sparseRow,ket1,ket2,
+					                    i,orb,basis);
+
+					setSpinOrbitOffDiagonal(sparseRow,ket1,ket2,
+					                    i,orb,basis);
+
+				} else if (mp_.feAsMode == 1 || mp_.feAsMode == 2) {
+					setOffDiagonalDecay(sparseRow,ket1,ket2,
+					                    i,orb,basis);
+				} else if (mp_.feAsMode == 3) {
+					setOffDiagonalJimpurity(sparseRow,ket1,ket2,i,orb,basis);
+				} else if (mp_.feAsMode == 4) {
+					setOffDiagonalKspace(sparseRow,ket1,ket2,i,orb,basis);
+				}
+			}
+		}
+	}
+
 	void setOffDiagonalDecay(SparseRowType& sparseRow,
 	                         const WordType& ket1,
 	                         const WordType& ket2,
@@ -331,37 +303,34 @@ private:
 		WordType s2i=(ket2 & BasisType::bitmask(ii));
 		if (s2i>0) s2i=1;
 
-		SizeType nsite = geometry_.numberOfSites();
-
 		// Hopping term
-		for (SizeType j=0;j<nsite;j++) {
-			if (j<i) continue;
-			for (SizeType orb2=0;orb2<mp_.orbitals;orb2++) {
-				SizeType jj = j*mp_.orbitals+orb2;
-				ComplexOrRealType h = hoppings(i,orb,j,orb2);
-				if (PsimagLite::real(h) == 0 && PsimagLite::imag(h) == 0) continue;
-				WordType s1j= (ket1 & BasisType::bitmask(jj));
-				if (s1j>0) s1j=1;
-				WordType s2j= (ket2 & BasisType::bitmask(jj));
-				if (s2j>0) s2j=1;
-
-				if (s1i+s1j==1) {
-					WordType bra1= ket1 ^(BasisType::bitmask(ii)|BasisType::bitmask(jj));
-					SizeType temp = basis.perfectIndex(bra1,ket2);
-					RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
-					RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_UP);
-					ComplexOrRealType cTemp = h*extraSign*tmp2;
-					sparseRow.add(temp,cTemp);
+		for (SizeType k=hoppingBonds_.begin(ii);k<hoppingBonds_.end(ii);k++) {
+			const typename BondListType::Bond& bond = hoppingBonds_(k);
+			SizeType j = bond.site;
+			SizeType orb2 = bond.orb;
+			SizeType jj = j*mp_.orbitals+orb2;
+			const ComplexOrRealType& h = bond.value;
+			WordType s1j= (ket1 & BasisType::bitmask(jj));
+			if (s1j>0) s1j=1;
+			WordType s2j= (ket2 & BasisType::bitmask(jj));
+			if (s2j>0) s2j=1;
+
+			if (s1i+s1j==1) {
+				WordType bra1= ket1 ^ bond.mask;
+				SizeType temp = basis.perfectIndex(bra1,ket2);
+				RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
+				RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_UP);
+				ComplexOrRealType cTemp = h*extraSign*tmp2;
+				sparseRow.add(temp,cTemp);
 
-				}
-				if (s2i+s2j==1) {
-					WordType bra2= ket2 ^(BasisType::bitmask(ii)|BasisType::bitmask(jj));
-					SizeType temp = basis.perfectIndex(ket1,bra2);
-					RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
-					RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_DOWN);
-					ComplexOrRealType cTemp = h*extraSign*tmp2;
-					sparseRow.add(temp,cTemp);
-				}
+			}
+			if (s2i+s2j==1) {
+				WordType bra2= ket2 ^ bond.mask;
+				SizeType temp = basis.perfectIndex(ket1,bra2);
+				RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
+				RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_DOWN);
+				ComplexOrRealType cTemp = h*extraSign*tmp2;
+				sparseRow.add(temp,cTemp);
 			}
 		}
 	}
@@ -484,9 +453,9 @@ private:
 	        SizeType orb,
 	        const BasisBaseType& basis) const
 	{
-		for (SizeType j=0;j<geometry_.numberOfSites();j++) {
-			ComplexOrRealType value = jCoupling(i,j,TERM_J_PM)*0.5;
-			if (PsimagLite::real(value) == 0 && PsimagLite::imag(value) == 0) continue;
+		for (SizeType k=jPmBonds_.begin(i);k<jPmBonds_.end(i);k++) {
+			SizeType j = jPmBonds_(k).site;
+			ComplexOrRealType value = jPmBonds_(k).value*0.5;
 			value *= 0.5; // RealType counting i,j
 			assert(i!=j);
 			for (SizeType orb2=0;orb2<mp_.orbitals;orb2++) {
@@ -527,6 +496,13 @@ private:
 		}
 	}
 
+	RealType diagonalElement(SizeType ispace,const BasisBaseType& basis) const
+	{
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		return findS(geometry_.numberOfSites(),ket1,ket2,ispace,basis);
+	}
+
 	RealType findS(SizeType nsite,
 	               WordType ket1,
 	               WordType ket2,
@@ -558,7 +534,7 @@ private:
 		return s;
 	}
 
-	RealType findSnoDecay(SizeType nsite,
+	RealType findSnoDecay(SizeType,
 	                      WordType ket1,
 	                      WordType ket2,
 	                      SizeType i,
@@ -581,10 +557,10 @@ private:
 		}
 
 		// JNN and JNNN diagonal part
-		for (SizeType j=0;j<nsite;j++) {
+		for (SizeType k=jZzBonds_.begin(i);k<jZzBonds_.end(i);k++) {
+			SizeType j = jZzBonds_(k).site;
+			const ComplexOrRealType& value = jZzBonds_(k).value;
 			for (SizeType orb2=0;orb2<mp_.orbitals;orb2++) {
-				ComplexOrRealType value = jCoupling(i,j,TERM_J_ZZ);
-				if (PsimagLite::real(value) == 0 && PsimagLite::imag(value) == 0) continue;
 				s += value*0.5* // RealType counting i,j
 				        szTerm(ket1,ket2,i,orb,basis)*
 				        szTerm(ket1,ket2,j,orb2,basis);
@@ -820,7 +796,10 @@ private:
 	const GeometryType& geometry_;
 	BasisType basis_;
 	GeometryDcaType geometryDca_;
-	mutable typename PsimagLite::Vector<BasisType*>::Type garbage_;
+	BondListType hoppingBonds_;
+	BondListType jPmBonds_;
+	BondListType jZzBonds_;
+	mutable DiagonalCacheType diagonalCache_;
 }; // class FeBasedSc
 
 } // namespace LanczosPlusPlus
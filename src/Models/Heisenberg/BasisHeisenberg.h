@@ -5,6 +5,7 @@
 #define LANCZOS_BASIS_HEISENBERG_H
 
 #include "BitManip.h"
+#include "Matrix.h"
 #include "ProgramGlobals.h"
 #include "../../Engine/BasisBase.h"
 
@@ -36,19 +37,17 @@ public:
 		SizeType sites = geometry_.numberOfSites();
 		assert(bitmask_.size()==0 || bitmask_.size()== sites);
 		if (bitmask_.size()==0) doBitmask();
-		WordType searchTotal = 1;
 		assert(twiceS > 0);
 		bits_ = 1 + static_cast<SizeType>(logBase2(twiceS + 1));
 		if (twiceS & 1) bits_--;
-		searchTotal <<= (bits_ * sites);
 
-		WordType mask = getMask();
+		doCounts(sites);
 
-		for (WordType lui = 0; lui < searchTotal; ++lui) {
-			int tmp = mOf(lui,mask);
-			if (tmp < 0 || static_cast<SizeType>(tmp) != szPlusConst) continue;
-			data_.push_back(lui);
-		}
+		// only the words of this sector, in increasing order
+		if (counts_(sites,szPlusConst_) > 0)
+			fillBasis(sites,szPlusConst_,0);
+
+		assert(data_.size() == counts_(sites,szPlusConst_));
 	}
 
 	static const WordType& bitmask(SizeType i)
@@ -70,13 +69,30 @@ public:
 		throw PsimagLite::RuntimeError("BasisHeisenberg::perfectIndex kets\n");
 	}
 
+	// Number of words of this sector smaller than ket, site by site
+	// from the most significant one
 	SizeType perfectIndex(WordType ket,WordType) const
 	{
-		for (SizeType i = 0; i < data_.size(); ++i) {
-			if (ket == data_[i]) return i;
+		SizeType sites = geometry_.numberOfSites();
+		WordType mask = getMask();
+		SizeType remaining = szPlusConst_;
+		SizeType index = 0;
+		WordType word = ket;
+		for (SizeType site = sites; site > 0; --site) {
+			SizeType lower = site - 1;
+			SizeType digit = ((word >> (lower*bits_)) & mask);
+			if (digit > twiceS_ || digit > remaining) break;
+			// words with a smaller digit here come first
+			index += cumulative_(lower,remaining) - cumulative_(lower,remaining - digit);
+			remaining -= digit;
+			word &= ~(mask << (lower*bits_));
 		}
 
-		throw PsimagLite::RuntimeError("perfectIndex: no index found\n");
+		if (word != 0 || remaining != 0 || index >= data_.size())
+			throw PsimagLite::RuntimeError("perfectIndex: no index found\n");
+
+		assert(data_[index] == ket);
+		return index;
 	}
 
 	WordType operator()(SizeType i, SizeType) const
@@ -196,35 +212,48 @@ private:
 
 	WordType getMask() const
 	{
-		SizeType mask = 1;
-		for (SizeType i = 0; i < bits_; ++i)
-			mask |= bitmask_[i];
-		return mask;
+		WordType mask = 1;
+		mask <<= bits_;
+		return mask - 1;
 	}
 
-	int mOf(WordType lui, WordType mask) const
+	// counts_(k,m) is the number of k-digit words, each digit in [0,twiceS],
+	// adding up to m; cumulative_(k,m) = counts_(k,0) + ... + counts_(k,m)
+	void doCounts(SizeType sites)
 	{
-		SizeType m = 0;
-		bool allowed = true;
-		while (lui != 0) {
-			WordType tmp = (lui & mask);
-			if (!mOfIsAllowed(tmp)) {
-				allowed = false;
-				break;
+		counts_.reset(sites + 1,szPlusConst_ + 1);
+		cumulative_.reset(sites + 1,szPlusConst_ + 1);
+		for (SizeType k = 0; k <= sites; ++k) {
+			for (SizeType m = 0; m <= szPlusConst_; ++m) {
+				SizeType c = (m == 0) ? 1 : 0;
+				if (k > 0) {
+					c = 0;
+					SizeType maxDigit = (m < twiceS_) ? m : twiceS_;
+					for (SizeType v = 0; v <= maxDigit; ++v)
+						c += counts_(k - 1,m - v);
+				}
+
+				counts_(k,m) = c;
+				cumulative_(k,m) = (m > 0) ? cumulative_(k,m - 1) + c : c;
 			}
-
-			m += tmp;
-			lui >>= bits_;
 		}
-
-		return (allowed) ? m : -1;
 	}
 
-	bool mOfIsAllowed(WordType val) const
+	// Sets the digit of site-1, then recurses into the lower sites
+	void fillBasis(SizeType site, SizeType remaining, WordType word)
 	{
-		if (twiceS_ & 1) return true;
+		if (site == 0) {
+			data_.push_back(word);
+			return;
+		}
 
-		return (val <= twiceS_);
+		SizeType lower = site - 1;
+		SizeType maxDigit = (remaining < twiceS_) ? remaining : twiceS_;
+		for (SizeType v = 0; v <= maxDigit; ++v) {
+			if (counts_(lower,remaining - v) == 0) continue;
+			WordType digit = v;
+			fillBasis(lower,remaining - v,word | (digit << (lower*bits_)));
+		}
 	}
 
 	PairIntType getBraIndexSplusSminus(WordType ket1,
@@ -290,6 +319,8 @@ private:
 	SizeType szPlusConst_;
 	SizeType bits_;
 	VectorWordType data_;
+	PsimagLite::Matrix<SizeType> counts_;
+	PsimagLite::Matrix<SizeType> cumulative_;
 }; // class BasisHeisenberg
 
 template<typename GeometryType>
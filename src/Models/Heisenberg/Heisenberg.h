@@ -11,16 +11,25 @@
 #include "BasisHeisenberg.h"
 #include "ParametersHeisenberg.h"
 #include "ModelBase.h"
+#include "ParallelHamiltonianSetup.h"
+#include "ParallelMatrixVectorProduct.h"
+#include "DiagonalCache.h"
+#include "BondList.h"
 
 namespace LanczosPlusPlus {
 
 template<typename ComplexOrRealType,typename GeometryType,typename InputType>
 class Heisenberg  : public ModelBase<ComplexOrRealType,GeometryType,InputType> {
 
+	typedef Heisenberg<ComplexOrRealType,GeometryType,InputType> ThisType;
 	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef std::pair<SizeType,SizeType> PairType;
 	typedef ModelBase<ComplexOrRealType,GeometryType,InputType> BaseType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	friend class ParallelHamiltonianSetup<ThisType>;
+	friend class ParallelMatrixVectorProduct<ThisType>;
 
 	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
 
@@ -29,11 +38,15 @@ public:
 	typedef ParametersHeisenberg<RealType,InputType> ParametersModelType;
 	typedef BasisHeisenberg<GeometryType> BasisType;
 	typedef typename BasisType::BaseType BasisBaseType;
+	typedef DiagonalCache<RealType,BasisBaseType> DiagonalCacheType;
 	typedef typename BasisType::WordType WordType;
+	typedef BondList<ComplexOrRealType,WordType> BondListType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
 	typedef typename BaseType::VectorType VectorType;
 	typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
 
+	friend class DiagonalCache<RealType,BasisBaseType>;
+
 	Heisenberg(SizeType szPlusConst,
 	           InputType& io,
 	           const GeometryType& geometry)
@@ -56,11 +69,17 @@ public:
 				jzz_(i,j) = geometry_(i,0,j,0,1);
 			}
 		}
-	}
 
-	~Heisenberg()
-	{
-		BaseType::deleteGarbage(garbage_);
+		for (SizeType i=0;i<n;i++) {
+			for (SizeType j=0;j<n;j++) {
+				if (j == i) continue;
+				jPmBonds_.push(j,0,0,jpm_(i,j));
+				if (j > i) jZzBonds_.push(j,0,0,jzz_(i,j));
+			}
+
+			jPmBonds_.closeOrigin();
+			jZzBonds_.closeOrigin();
+		}
 	}
 
 	SizeType size() const { return basis_.size(); }
@@ -80,36 +99,27 @@ public:
 	                      const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert,0.0);
+		VectorRealType diag(hilbert,0.0);
 		calcDiagonalElements(diag,basis);
 
-		SizeType nsite = geometry_.numberOfSites();
-		SizeType dummy = 0;
-		SizeType orb = 0;
-
-		matrix.resize(hilbert,hilbert);
-		// Calculate off-diagonal elements AND store matrix
-		SizeType nCounter=0;
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			SparseRowType sparseRow;
-			matrix.setRow(ispace,nCounter);
-
-			WordType ket = basis(ispace,dummy);
-			// Save diagonal
-			sparseRow.add(ispace,diag[ispace]);
-			for (SizeType i=0;i<nsite;i++) {
-				SizeType val1 = basis.getN(ket,dummy,i,dummy,orb);
-				if (val1 == mp_.twiceTheSpin) continue;
-				val1++;
-				setSplusSminus(sparseRow,ket,i,val1,basis);
-			}
+		ParallelHamiltonianSetup<ThisType> parallelSetup(*this,diag,basis);
+		parallelSetup(matrix);
+		assert(isHermitian(matrix));
+	}
 
-			nCounter += sparseRow.finalize(matrix);
-		}
+	void matrixVectorProduct(VectorType &x,const VectorType& y) const
+	{
+		matrixVectorProduct(x,y,basis_,PsimagLite::Concurrency::npthreads);
+	}
 
-		matrix.setRow(hilbert,nCounter);
-		matrix.checkValidity();
-		assert(isHermitian(matrix));
+	void matrixVectorProduct(VectorType &x,
+	                         const VectorType& y,
+	                         const BasisBaseType& basis,
+	                         SizeType threads) const
+	{
+		const VectorRealType& diag = diagonalCache_(*this,basis,threads);
+		ParallelMatrixVectorProduct<ThisType> parallelProduct(*this,diag,basis,threads);
+		parallelProduct(x,y);
 	}
 
 	bool hasNewParts(std::pair<SizeType,SizeType>& newParts,
@@ -142,11 +152,9 @@ public:
 
 	PsimagLite::String name() const { return __FILE__; }
 
-	BasisType* createBasis(SizeType nup, SizeType ndown) const
+	BasisType* newBasis(SizeType nup, SizeType ndown) const
 	{
-		BasisType* ptr = new BasisType(geometry_,nup,ndown);
-		garbage_.push_back(ptr);
-		return ptr;
+		return new BasisType(geometry_,nup,ndown);
 	}
 
 	void print(std::ostream& os) const { os<<mp_; }
@@ -163,6 +171,49 @@ public:
 
 private:
 
+	// Pushes row ispace of the Hamiltonian into matrix, returns its nonzeros
+	SizeType setupRow(SparseMatrixType& matrix,
+	                  SizeType ispace,
+	                  const VectorRealType& diag,
+	                  const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SizeType dummy = 0;
+		SizeType orb = 0;
+		SparseRowType sparseRow;
+		WordType ket = basis(ispace,dummy);
+		// Save diagonal
+		sparseRow.add(ispace,diag[ispace]);
+		for (SizeType i=0;i<nsite;i++) {
+			SizeType val1 = basis.getN(ket,dummy,i,dummy,orb);
+			if (val1 == mp_.twiceTheSpin) continue;
+			val1++;
+			setSplusSminus(sparseRow,ket,i,val1,basis);
+		}
+
+		return sparseRow.finalize(matrix);
+	}
+
+	// Off-diagonal part of row ispace times y
+	ComplexOrRealType offDiagonalProduct(const VectorType& y,
+	                                     SizeType ispace,
+	                                     const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SizeType dummy = 0;
+		SizeType orb = 0;
+		SparseRowType sparseRow;
+		WordType ket = basis(ispace,dummy);
+		for (SizeType i=0;i<nsite;i++) {
+			SizeType val1 = basis.getN(ket,dummy,i,dummy,orb);
+			if (val1 == mp_.twiceTheSpin) continue;
+			val1++;
+			setSplusSminus(sparseRow,ket,i,val1,basis);
+		}
+
+		return sparseRow.finalize(y);
+	}
+
 	void printOperatorSz(SizeType site, std::ostream& os) const
 	{
 		SizeType sites = geometry_.numberOfSites();
@@ -241,34 +292,36 @@ private:
 	                          const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
+		for (SizeType ispace=0;ispace<hilbert;ispace++)
+			diag[ispace] = diagonalElement(ispace,basis);
+	}
+
+	RealType diagonalElement(SizeType ispace,const BasisBaseType& basis) const
+	{
 		SizeType nsite = geometry_.numberOfSites();
 		SizeType orb = 0;
 		SizeType dummy = 0;
+		WordType ket = basis(ispace,dummy);
+		ComplexOrRealType s=0;
+		for (SizeType i=0;i<nsite;i++) {
 
-		// Calculate diagonal elements
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			WordType ket = basis(ispace,dummy);
-			ComplexOrRealType s=0;
-			for (SizeType i=0;i<nsite;i++) {
-
-				SizeType val1 = basis.getN(ket,dummy,i,dummy,orb);
-				RealType tmp1 = val1 - mp_.twiceTheSpin*0.5;
+			SizeType val1 = basis.getN(ket,dummy,i,dummy,orb);
+			RealType tmp1 = val1 - mp_.twiceTheSpin*0.5;
 
-				if (i < mp_.magneticField.size()) s += mp_.magneticField[i]*tmp1;
+			if (i < mp_.magneticField.size()) s += mp_.magneticField[i]*tmp1;
 
-				for (SizeType j=i+1;j<nsite;j++) {
+			for (SizeType k=jZzBonds_.begin(i);k<jZzBonds_.end(i);k++) {
 
-					SizeType val2 = basis.getN(ket,dummy,j,dummy,orb);
-					RealType tmp2 = val2 - mp_.twiceTheSpin*0.5;
+				SizeType val2 = basis.getN(ket,dummy,jZzBonds_(k).site,dummy,orb);
+				RealType tmp2 = val2 - mp_.twiceTheSpin*0.5;
 
-					// Sz Sz term:
-					s += tmp1*tmp2*jzz_(i,j);
-				}
+				// Sz Sz term:
+				s += tmp1*tmp2*jZzBonds_(k).value;
 			}
-
-			assert(fabs(PsimagLite::imag(s))<1e-12);
-			diag[ispace] = PsimagLite::real(s);
 		}
+
+		assert(fabs(PsimagLite::imag(s))<1e-12);
+		return PsimagLite::real(s);
 	}
 
 	void setSplusSminus(SparseRowType &sparseRow,
@@ -277,15 +330,12 @@ private:
 	                    SizeType val1,
 	                    const BasisBaseType &basis) const
 	{
-		SizeType nsite = geometry_.numberOfSites();
 		SizeType dummy = 0;
 		SizeType orb = 0;
 		RealType spin = mp_.twiceTheSpin*0.5;
 
-		for (SizeType j=0;j<nsite;j++) {
-			if (i == j) continue;
-			if (jpm_(i,j) == 0) continue;
-
+		for (SizeType k=jPmBonds_.begin(i);k<jPmBonds_.end(i);k++) {
+			SizeType j = jPmBonds_(k).site;
 			SizeType val2 = basis.getN(ket,dummy,j,dummy,orb);
 			if (val2 == 0) continue;
 			RealType m2 = val2 - spin;
@@ -297,7 +347,7 @@ private:
 			SizeType temp = basis.perfectIndex(bra,dummy);
 			RealType tmp = sqrt(spin*(spin+1.0) - m1*(m1+1.0));
 			tmp *= sqrt(spin*(spin+1.0) - m2*(m2-1.0));
-			sparseRow.add(temp,0.5*tmp*jpm_(i,j));
+			sparseRow.add(temp,0.5*tmp*jPmBonds_(k).value);
 		}
 	}
 
@@ -337,7 +387,9 @@ private:
 	BasisType basis_;
 	PsimagLite::Matrix<ComplexOrRealType> jpm_;
 	PsimagLite::Matrix<ComplexOrRealType> jzz_;
-	mutable typename PsimagLite::Vector<BasisType*>::Type garbage_;
+	BondListType jPmBonds_;
+	BondListType jZzBonds_;
+	mutable DiagonalCacheType diagonalCache_;
 }; // class Heisenberg
 } // namespace LanczosPlusPlus
 #endif
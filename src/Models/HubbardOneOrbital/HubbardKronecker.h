@@ -0,0 +1,228 @@
+/*
+// BEGIN LICENSE BLOCK
+Copyright (c) 2014, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file HubbardKronecker.h
+ *
+ *  H = T_up x 1 + 1 x T_down + D for the one-orbital Hubbard model
+ *
+ *  The basis index is iup + idown*nup, so a vector is a matrix with
+ *  nup rows and ndown columns. T_up acts on the columns of that matrix
+ *  and T_down on its rows; only the one-spin hopping tables are
+ *  stored, and the diagonal D is passed in by the model. Threads take
+ *  whole columns for T_up and whole rows for T_down, so each thread
+ *  writes only its own entries of x.
+ */
+#ifndef HUBBARD_KRONECKER_H
+#define HUBBARD_KRONECKER_H
+#include "BasisOneSpin.h"
+#include "Matrix.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ComplexOrRealType>
+class HubbardKronecker {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef BasisOneSpin::WordType WordType;
+
+	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
+
+	// Sparse hopping matrix of one spin species, rows are one-spin kets
+	class HoppingOneSpin {
+
+	public:
+
+		HoppingOneSpin(const BasisOneSpin& basis,
+		               const PsimagLite::Matrix<ComplexOrRealType>& hoppings,
+		               SizeType spin)
+		    : rowPtr_(basis.size() + 1,0)
+		{
+			SizeType nsite = hoppings.n_row();
+			for (SizeType ispace=0;ispace<basis.size();ispace++) {
+				rowPtr_[ispace] = cols_.size();
+				WordType ket = basis[ispace];
+				for (SizeType i=0;i<nsite;i++) {
+					WordType si = (ket & BasisOneSpin::bitmask(i)) ? 1 : 0;
+					for (SizeType j=i;j<nsite;j++) {
+						ComplexOrRealType h = hoppings(i,j);
+						if (PsimagLite::real(h) == 0 && PsimagLite::imag(h) == 0) continue;
+						WordType sj = (ket & BasisOneSpin::bitmask(j)) ? 1 : 0;
+						if (si+sj != 1) continue;
+
+						WordType bra = ket ^ (BasisOneSpin::bitmask(i)|BasisOneSpin::bitmask(j));
+						RealType extraSign = (si==1) ? BasisOneSpin::FERMION_SIGN : 1;
+						ComplexOrRealType cTemp = h*extraSign*RealType(basis.doSign(ket,i,j));
+						// same convention as HubbardOneOrbital::setHoppingTerm
+						bool conjugate = (spin == SPIN_UP) ? (si == 0) : (sj == 0);
+						if (conjugate) cTemp = PsimagLite::conj(cTemp);
+						cols_.push_back(basis.perfectIndex(bra));
+						values_.push_back(cTemp);
+					}
+				}
+			}
+
+			rowPtr_[basis.size()] = cols_.size();
+		}
+
+		SizeType size() const { return rowPtr_.size() - 1; }
+
+		SizeType nonZeros() const { return cols_.size(); }
+
+		SizeType rowPtr(SizeType i) const { return rowPtr_[i]; }
+
+		SizeType col(SizeType k) const { return cols_[k]; }
+
+		const ComplexOrRealType& value(SizeType k) const { return values_[k]; }
+
+	private:
+
+		VectorSizeType rowPtr_;
+		VectorSizeType cols_;
+		VectorType values_;
+	}; // class HoppingOneSpin
+
+	// T_up x 1: each column idown of x is a one-spin vector;
+	// threads take whole columns
+	class UpSweepHelper {
+
+	public:
+
+		UpSweepHelper(VectorType& x,const VectorType& y,const HoppingOneSpin& up)
+		    : x_(x),y_(y),up_(up)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType nupStates = up_.size();
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType idown = threadNum*blockSize + p;
+				if (idown>=total) break;
+				SizeType offset = idown*nupStates;
+				for (SizeType iup=0;iup<nupStates;iup++) {
+					ComplexOrRealType sum = 0;
+					for (SizeType k=up_.rowPtr(iup);k<up_.rowPtr(iup+1);k++)
+						sum += up_.value(k)*y_[offset + up_.col(k)];
+					x_[offset + iup] += sum;
+				}
+			}
+		}
+
+	private:
+
+		VectorType& x_;
+		const VectorType& y_;
+		const HoppingOneSpin& up_;
+	}; // class UpSweepHelper
+
+	// 1 x T_down: each row iup of x is a one-spin vector;
+	// threads take whole rows
+	class DownSweepHelper {
+
+	public:
+
+		DownSweepHelper(VectorType& x,
+		                const VectorType& y,
+		                SizeType nupStates,
+		                const HoppingOneSpin& down)
+		    : x_(x),y_(y),nupStates_(nupStates),down_(down)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			for (SizeType p=0;p<blockSize;p++) {
+				SizeType iup = threadNum*blockSize + p;
+				if (iup>=total) break;
+				for (SizeType idown=0;idown<down_.size();idown++) {
+					ComplexOrRealType sum = 0;
+					for (SizeType k=down_.rowPtr(idown);k<down_.rowPtr(idown+1);k++)
+						sum += down_.value(k)*y_[iup + down_.col(k)*nupStates_];
+					x_[iup + idown*nupStates_] += sum;
+				}
+			}
+		}
+
+	private:
+
+		VectorType& x_;
+		const VectorType& y_;
+		SizeType nupStates_;
+		const HoppingOneSpin& down_;
+	}; // class DownSweepHelper
+
+public:
+
+	HubbardKronecker(const PsimagLite::Matrix<ComplexOrRealType>& hoppings,
+	                 SizeType nup,
+	                 SizeType ndown)
+	    : nup_(nup),
+	      ndown_(ndown),
+	      up_(BasisOneSpin(hoppings.n_row(),nup),hoppings,SPIN_UP),
+	      down_(BasisOneSpin(hoppings.n_row(),ndown),hoppings,SPIN_DOWN)
+	{}
+
+	bool isSector(SizeType nup, SizeType ndown) const
+	{
+		return (nup_ == nup && ndown_ == ndown);
+	}
+
+	SizeType size() const { return up_.size()*down_.size(); }
+
+	// x += (T_up x 1 + 1 x T_down + D) y
+	void matrixVectorProduct(VectorType& x,
+	                         const VectorType& y,
+	                         const VectorRealType& diag,
+	                         SizeType threads) const
+	{
+		assert(x.size() == size() && y.size() == size() && diag.size() == size());
+
+		for (SizeType i=0;i<diag.size();i++)
+			x[i] += diag[i]*y[i];
+
+		typedef PsimagLite::Parallelizer<UpSweepHelper> ParallelizerUpType;
+		UpSweepHelper upHelper(x,y,up_);
+		ParallelizerUpType threadUp(threads,PsimagLite::MPI::COMM_WORLD);
+		threadUp.loopCreate(down_.size(),upHelper);
+
+		typedef PsimagLite::Parallelizer<DownSweepHelper> ParallelizerDownType;
+		DownSweepHelper downHelper(x,y,up_.size(),down_);
+		ParallelizerDownType threadDown(threads,PsimagLite::MPI::COMM_WORLD);
+		threadDown.loopCreate(up_.size(),downHelper);
+	}
+
+private:
+
+	SizeType nup_;
+	SizeType ndown_;
+	HoppingOneSpin up_;
+	HoppingOneSpin down_;
+}; // class HubbardKronecker
+} // namespace LanczosPlusPlus
+#endif // HUBBARD_KRONECKER_H
+
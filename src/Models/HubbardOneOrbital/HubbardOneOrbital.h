@@ -9,17 +9,28 @@
 #include "TypeToString.h"
 #include "SparseRow.h"
 #include "ParametersModelHubbard.h"
+#include "HubbardKronecker.h"
 #include "ProgramGlobals.h"
 #include "../../Engine/ModelBase.h"
+#include "../../Engine/ParallelHamiltonianSetup.h"
+#include "../../Engine/ParallelMatrixVectorProduct.h"
+#include "../../Engine/DiagonalCache.h"
+#include "../../Engine/BondList.h"
 
 namespace LanczosPlusPlus {
 
 template<typename ComplexOrRealType,typename GeometryType,typename InputType>
 class HubbardOneOrbital : public ModelBase<ComplexOrRealType,GeometryType,InputType> {
 
+	typedef HubbardOneOrbital<ComplexOrRealType,GeometryType,InputType> ThisType;
 	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef ModelBase<ComplexOrRealType,GeometryType,InputType> BaseType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef HubbardKronecker<ComplexOrRealType> HubbardKroneckerType;
+
+	friend class ParallelHamiltonianSetup<ThisType>;
+	friend class ParallelMatrixVectorProduct<ThisType>;
 
 	enum {TERM_HOPPING=0,TERM_NINJ=1,TERM_SUPER=2};
 
@@ -33,12 +44,16 @@ public:
 	typedef BasisHubbardLanczos<GeometryType> BasisType;
 	typedef typename BasisType::PairIntType PairIntType;
 	typedef typename BasisType::BaseType BasisBaseType;
+	typedef DiagonalCache<RealType,BasisBaseType> DiagonalCacheType;
 	typedef typename BasisType::WordType WordType;
+	typedef BondList<ComplexOrRealType,WordType> BondListType;
 	typedef typename BaseType::VectorSizeType VectorSizeType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
 	typedef typename BaseType::VectorType VectorType;
 	typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
 
+	friend class DiagonalCache<RealType,BasisBaseType>;
+
 	static int const FERMION_SIGN = BasisType::FERMION_SIGN;
 
 	HubbardOneOrbital(SizeType nup,
@@ -87,11 +102,27 @@ public:
 				hoppings_(i,j) = PsimagLite::conj(hoppings_(i,j));
 			}
 		}
+
+		for (SizeType i=0;i<n;i++) {
+			for (SizeType j=0;j<n;j++) {
+				WordType mask = BasisType::bitmask(i) | BasisType::bitmask(j);
+				if (j>=i) hoppingBonds_.push(j,0,mask,hoppings_(i,j));
+				jBonds_.push(j,0,mask,jCoupling(i,j));
+				coulombBonds_.push(j,0,mask,coulombCoupling(i,j));
+			}
+
+			hoppingBonds_.closeOrigin();
+			jBonds_.closeOrigin();
+			coulombBonds_.closeOrigin();
+		}
+
+		if (mp_.kroneckerProduct) addKronecker(nup,ndown);
 	}
 
 	~HubbardOneOrbital()
 	{
-		BaseType::deleteGarbage(garbage_);
+		for (SizeType i=0;i<kroneckers_.size();i++)
+			delete kroneckers_[i];
 	}
 
 	SizeType size() const { return basis_.size(); }
@@ -111,60 +142,31 @@ public:
 	                      const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert);
+		VectorRealType diag(hilbert);
 		calcDiagonalElements(diag,basis);
 
-		SizeType nsite = geometry_.numberOfSites();
-
-		matrix.resize(hilbert,hilbert);
-		// Calculate off-diagonal elements AND store matrix
-		SizeType nCounter=0;
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			SparseRowType sparseRow;
-			matrix.setRow(ispace,nCounter);
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			// Save diagonal
-			sparseRow.add(ispace,diag[ispace]);
-			for (SizeType i=0;i<nsite;i++) {
-				setHoppingTerm(sparseRow,ket1,ket2,i,basis);
-				setJTermOffDiagonal(sparseRow,ket1,ket2,i,basis);
-			}
-
-			nCounter += sparseRow.finalize(matrix);
-		}
-
-		matrix.setRow(hilbert,nCounter);
+		ParallelHamiltonianSetup<ThisType> parallelSetup(*this,diag,basis);
+		parallelSetup(matrix);
 	}
 
 	void matrixVectorProduct(VectorType &x,VectorType const &y) const
 	{
-		matrixVectorProduct(x,y,basis_);
+		matrixVectorProduct(x,y,basis_,PsimagLite::Concurrency::npthreads);
 	}
 
 	void matrixVectorProduct(VectorType &x,
 	                         VectorType const &y,
-	                         const BasisBaseType& basis) const
+	                         const BasisBaseType& basis,
+	                         SizeType threads) const
 	{
-		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert);
-		calcDiagonalElements(diag,basis);
-		for (SizeType ispace=0;ispace<hilbert;ispace++)
-			x[ispace] += diag[ispace]*y[ispace];
-		diag.clear();
-
-		SizeType nsite = geometry_.numberOfSites();
-		// Calculate off-diagonal elements AND store matrix
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			SparseRowType sparseRow;
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			for (SizeType i=0;i<nsite;i++) {
-				setHoppingTerm(sparseRow,ket1,ket2,i,basis);
-				setJTermOffDiagonal(sparseRow,ket1,ket2,i,basis);
-			}
-			x[ispace] += sparseRow.finalize(y);
+		if (mp_.kroneckerProduct) {
+			matrixVectorProductKronecker(x,y,basis,threads);
+			return;
 		}
+
+		const VectorRealType& diag = diagonalCache_(*this,basis,threads);
+		ParallelMatrixVectorProduct<ThisType> parallelProduct(*this,diag,basis,threads);
+		parallelProduct(x,y);
 	}
 
 	bool hasNewParts(std::pair<SizeType,SizeType>& newParts,
@@ -192,11 +194,12 @@ public:
 
 	PsimagLite::String name() const { return __FILE__; }
 
-	BasisType* createBasis(SizeType nup, SizeType ndown) const
+	// With KroneckerProduct the tables of the sector are made here, once,
+	// so that the products only read them
+	BasisType* newBasis(SizeType nup, SizeType ndown) const
 	{
-		BasisType* ptr = new BasisType(geometry_,nup,ndown);
-		garbage_.push_back(ptr);
-		return ptr;
+		if (mp_.kroneckerProduct) addKronecker(nup,ndown);
+		return new BasisType(geometry_,nup,ndown);
 	}
 
 	void print(std::ostream& os) const { os<<mp_; }
@@ -225,12 +228,13 @@ private:
 			return;
 		}
 
-		BasisType*  basis = createBasis(nup-1, ndown);
+		const BasisBaseType* basis = BaseType::createBasis(nup-1, ndown);
 		VectorSizeType opt(2,0);
 		opt[0] = site;
 		opt[1] = spin;
 		MatrixType matrix;
 		setupOperator(matrix,*basis,"c",opt);
+		BaseType::releaseBasis(basis);
 		os<<"#Operator_c_"<<spin<<"_"<<site<<"\n";
 		os<<"#SectorDest 2 "<<(nup-1)<<" "<<ndown<<"\n";
 		os<<"#Matrix\n";
@@ -332,56 +336,132 @@ private:
 		return true;
 	}
 
+	// Tables of sector (nup,ndown); a sector shares them with its
+	// later bases, and they are kept until the model is destroyed
+	void addKronecker(SizeType nup,SizeType ndown) const
+	{
+		for (SizeType i=0;i<kroneckers_.size();i++)
+			if (kroneckers_[i]->isSector(nup,ndown)) return;
+		kroneckers_.push_back(new HubbardKroneckerType(hoppings_,nup,ndown));
+	}
+
+	const HubbardKroneckerType& kronecker(SizeType nup,SizeType ndown) const
+	{
+		for (SizeType i=0;i<kroneckers_.size();i++)
+			if (kroneckers_[i]->isSector(nup,ndown)) return *kroneckers_[i];
+		throw PsimagLite::RuntimeError("HubbardOneOrbital: no Kronecker tables for sector\n");
+	}
+
+	// Hopping and diagonal from one-spin tables, only J mixes spins
+	void matrixVectorProductKronecker(VectorType &x,
+	                                  VectorType const &y,
+	                                  const BasisBaseType& basis,
+	                                  SizeType threads) const
+	{
+		SizeType nup = PsimagLite::BitManip::count(basis(0,SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis(0,SPIN_DOWN));
+		const HubbardKroneckerType& kronecker = this->kronecker(nup,ndown);
+		assert(kronecker.size() == basis.size());
+		kronecker.matrixVectorProduct(x,y,diagonalCache_(*this,basis,threads),threads);
+
+		if (!hasJcoupling_) return;
+
+		// hoppings are already in; offDiagonalProduct adds only J
+		VectorRealType noDiagonal;
+		ParallelMatrixVectorProduct<ThisType> parallelProduct(*this,noDiagonal,basis,threads);
+		parallelProduct(x,y);
+	}
+
+	// Off-diagonal part of row ispace times y; with KroneckerProduct
+	// the hoppings are done by the Kronecker tables and only J is added here
+	ComplexOrRealType offDiagonalProduct(const VectorType& y,
+	                                     SizeType ispace,
+	                                     const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SparseRowType sparseRow;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		for (SizeType i=0;i<nsite;i++) {
+			if (!mp_.kroneckerProduct)
+				setHoppingTerm(sparseRow,ket1,ket2,i,basis);
+			setJTermOffDiagonal(sparseRow,ket1,ket2,i,basis);
+		}
+
+		return sparseRow.finalize(y);
+	}
+
+	// Pushes row ispace of the Hamiltonian into matrix, returns its nonzeros
+	SizeType setupRow(SparseMatrixType& matrix,
+	                  SizeType ispace,
+	                  const VectorRealType& diag,
+	                  const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SparseRowType sparseRow;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		// Save diagonal
+		sparseRow.add(ispace,diag[ispace]);
+		for (SizeType i=0;i<nsite;i++) {
+			setHoppingTerm(sparseRow,ket1,ket2,i,basis);
+			setJTermOffDiagonal(sparseRow,ket1,ket2,i,basis);
+		}
+
+		return sparseRow.finalize(matrix);
+	}
+
 	void calcDiagonalElements(typename PsimagLite::Vector<RealType>::Type& diag,
 	                          const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
+		for (SizeType ispace=0;ispace<hilbert;ispace++)
+			diag[ispace] = diagonalElement(ispace,basis);
+	}
+
+	RealType diagonalElement(SizeType ispace,const BasisBaseType& basis) const
+	{
 		SizeType nsite = geometry_.numberOfSites();
 		SizeType orb = 0;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		ComplexOrRealType s=0;
+		for (SizeType i=0;i<nsite;i++) {
+
+			// Hubbard term U0
+			s += mp_.hubbardU[i] *
+			        basis.isThereAnElectronAt(ket1,ket2,i,SPIN_UP,orb) *
+			        basis.isThereAnElectronAt(ket1,ket2,i,SPIN_DOWN,orb);
+
+			// SzSz
+			for (SizeType k=jBonds_.begin(i);k<jBonds_.end(i);k++) {
+				const typename BondListType::Bond& bond = jBonds_(k);
+				s += bond.value*0.5* // double counting i,j
+				        szTerm(ket1,ket2,i,basis)*
+				        szTerm(ket1,ket2,bond.site,basis);
+			}
 
-		// Calculate diagonal elements
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			ComplexOrRealType s=0;
-			for (SizeType i=0;i<nsite;i++) {
-
-				// Hubbard term U0
-				s += mp_.hubbardU[i] *
-				        basis.isThereAnElectronAt(ket1,ket2,i,SPIN_UP,orb) *
-				        basis.isThereAnElectronAt(ket1,ket2,i,SPIN_DOWN,orb);
-
-				// SzSz
-				for (SizeType j=0;j<nsite;j++) {
-					ComplexOrRealType value = jCoupling(i,j);
-					if (PsimagLite::real(value) == 0 && PsimagLite::imag(value) == 0) continue;
-					s += value*0.5* // double counting i,j
-					        szTerm(ket1,ket2,i,basis)*
-					        szTerm(ket1,ket2,j,basis);
-				}
-
-				// Coulomb
-				RealType ne = (basis.getN(ket1,ket2,i,SPIN_UP,orb) +
-				               basis.getN(ket1,ket2,i,SPIN_DOWN,orb));
-
-				for (SizeType j=0;j<nsite;j++) {
-					ComplexOrRealType value = coulombCoupling(i,j);
-					if (PsimagLite::real(value) == 0 && PsimagLite::imag(value) == 0) continue;
-					RealType tmp2 = basis.getN(ket1,ket2,j,SPIN_UP,orb) +
-					        basis.getN(ket1,ket2,j,SPIN_DOWN,orb);
-					s += value * ne * tmp2;
-				}
-
-				// Potential term
-				RealType tmp = mp_.potentialV[i];
-				if (mp_.potentialT.size()>0)
-					tmp += mp_.potentialT[i]*mp_.timeFactor;
-				if (tmp!=0) s += tmp * ne;
+			// Coulomb
+			RealType ne = (basis.getN(ket1,ket2,i,SPIN_UP,orb) +
+			               basis.getN(ket1,ket2,i,SPIN_DOWN,orb));
+
+			for (SizeType k=coulombBonds_.begin(i);k<coulombBonds_.end(i);k++) {
+				const typename BondListType::Bond& bond = coulombBonds_(k);
+				SizeType j = bond.site;
+				RealType tmp2 = basis.getN(ket1,ket2,j,SPIN_UP,orb) +
+				        basis.getN(ket1,ket2,j,SPIN_DOWN,orb);
+				s += bond.value * ne * tmp2;
 			}
 
-			assert(fabs(PsimagLite::imag(s))<1e-12);
-			diag[ispace] = PsimagLite::real(s);
+			// Potential term
+			RealType tmp = mp_.potentialV[i];
+			if (mp_.potentialT.size()>0)
+				tmp += mp_.potentialT[i]*mp_.timeFactor;
+			if (tmp!=0) s += tmp * ne;
 		}
+
+		assert(fabs(PsimagLite::imag(s))<1e-12);
+		return PsimagLite::real(s);
 	}
 
 	void setHoppingTerm(SparseRowType& sparseRow,
@@ -395,21 +475,20 @@ private:
 		WordType s2i=(ket2 & BasisType::bitmask(i));
 		if (s2i>0) s2i=1;
 
-		SizeType nsite = geometry_.numberOfSites();
 		SizeType orb = 0;
 
 		// Hopping term
-		for (SizeType j=0;j<nsite;j++) {
-			if (j<i) continue;
-			ComplexOrRealType h = hoppings_(i,j);
-			if (PsimagLite::real(h) == 0 && PsimagLite::imag(h) == 0) continue;
+		for (SizeType k=hoppingBonds_.begin(i);k<hoppingBonds_.end(i);k++) {
+			const typename BondListType::Bond& bond = hoppingBonds_(k);
+			SizeType j = bond.site;
+			const ComplexOrRealType& h = bond.value;
 			WordType s1j= (ket1 & BasisType::bitmask(j));
 			if (s1j>0) s1j=1;
 			WordType s2j= (ket2 & BasisType::bitmask(j));
 			if (s2j>0) s2j=1;
 
 			if (s1i+s1j==1) {
-				WordType bra1= ket1 ^(BasisType::bitmask(i)|BasisType::bitmask(j));
+				WordType bra1= ket1 ^ bond.mask;
 				SizeType temp = basis.perfectIndex(bra1,ket2);
 				RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
 				RealType tmp2 = basis.doSign(ket1,ket2,i,orb,j,orb,SPIN_UP);
@@ -420,7 +499,7 @@ private:
 			}
 
 			if (s2i+s2j==1) {
-				WordType bra2= ket2 ^(BasisType::bitmask(i)|BasisType::bitmask(j));
+				WordType bra2= ket2 ^ bond.mask;
 				SizeType temp = basis.perfectIndex(ket1,bra2);
 				RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
 				RealType tmp2 = basis.doSign(ket1,ket2,i,orb,j,orb,SPIN_DOWN);
@@ -438,9 +517,9 @@ private:
 	                         SizeType i,
 	                         const BasisBaseType& basis) const
 	{
-		for (SizeType j=0;j<geometry_.numberOfSites();j++) {
-			ComplexOrRealType value = jCoupling(i,j)*0.5;
-			if (PsimagLite::real(value) == 0 && PsimagLite::imag(value) == 0) continue;
+		for (SizeType k=jBonds_.begin(i);k<jBonds_.end(i);k++) {
+			SizeType j = jBonds_(k).site;
+			ComplexOrRealType value = jBonds_(k).value*0.5;
 			value *= 0.5; // double counting i,j
 			assert(i!=j);
 
@@ -523,7 +602,11 @@ private:
 	PsimagLite::Matrix<ComplexOrRealType> hoppings_;
 	bool hasJcoupling_;
 	bool hasCoulombCoupling_;
-	mutable typename PsimagLite::Vector<BasisType*>::Type garbage_;
+	BondListType hoppingBonds_;
+	BondListType jBonds_;
+	BondListType coulombBonds_;
+	mutable DiagonalCacheType diagonalCache_;
+	mutable typename PsimagLite::Vector<HubbardKroneckerType*>::Type kroneckers_;
 }; // class HubbardOneOrbital
 } // namespace LanczosPlusPlus
 #endif
@@ -98,6 +98,13 @@ struct ParametersModelHubbard {
 			io.read(potentialT,"PotentialT");
 			io.readline(timeFactor,"timeFactor=");
 		} catch (std::exception& e) {}
+
+		kroneckerProduct = false;
+		try {
+			PsimagLite::String tmp;
+			io.readline(tmp,"SolverOptions=");
+			kroneckerProduct = (tmp.find("KroneckerProduct") != PsimagLite::String::npos);
+		} catch (std::exception& e) {}
 	}
 
 	PsimagLite::String model;
@@ -109,6 +116,8 @@ struct ParametersModelHubbard {
 	typename PsimagLite::Vector<Field>::Type potentialV;
 	typename PsimagLite::Vector<Field>::Type potentialT;
 	Field timeFactor;
+	// matrix-free product with one-spin hopping tables
+	bool kroneckerProduct;
 };
 
 //! Function that prints model parameters to stream os
@@ -98,8 +98,8 @@ public:
 			SizeType oldIndex1 = ispace / basis1_.size();
 			return basis1_.perfectIndex(newKet) + oldIndex1*basis1_.size();
 		}
-		SizeType oldIndex2 = ispace % basis2_.size();
-		return oldIndex2 + basis2_.perfectIndex(newKet) * basis2_.size();
+		SizeType oldIndex1 = ispace % basis1_.size();
+		return oldIndex1 + basis2_.perfectIndex(newKet) * basis1_.size();
 	}
 
 	SizeType perfectIndex(WordType ket1,WordType ket2) const
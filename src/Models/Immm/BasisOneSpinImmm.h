@@ -68,8 +68,13 @@ namespace LanczosPlusPlus {
 			SizeType tmp = comb_(levels,npart);
 			data_.resize(tmp);
 
-			levels = orbsPerSite_.size()*orbs();
-			tmp = comb_(levels,npart);
+			offsets_.resize(npart+1,0);
+			tmp = 0;
+			for (SizeType na=0;na<=npart;na++) {
+				offsets_[na] = tmp;
+				tmp += comb_(nsite_,na) * comb_(nsite_,npart-na);
+			}
+
 			reordering_.resize(tmp);
 
 			// compute basis:
@@ -102,32 +107,32 @@ namespace LanczosPlusPlus {
 			}
 		}
 
+		// p(ket) = \sum_{na'=0}^{na'<na} S_na' * S_nb'
+		//			+ p_A(ket_A)*S_nb + p_B(ket_B)
+		// where S_x = C^n_x, and reordering_ skips the forbidden kets
 		SizeType perfectIndex(WordType ket) const
 		{
-			for (SizeType i=0;i<data_.size();i++)
-				if (data_[i]==ket) return i;
-			print(std::cout,true);
-			assert(false);
-			return 0;
-// 			WordType ketA=0,ketB=0;
-// 			uncollateKet(ketA,ketB,ket);
-// 			// p(ket) = \sum_{na'=0}^{na'<na} S_na' * S_nb'
-// 			//			+ p_A(ket_A)*S_nb + p_B(ket_B)
-// 			// where S_x = C^n_x
-// 			SizeType na = PsimagLite::BitManip::count(ketA);
-// 			// note nb = PsimagLite::BitManip::count(ketB)
-// 			// or nb  = npart -na
-// 			SizeType s = 0;
-// 			for (SizeType nap=0;nap<na;nap++) {
-// 				SizeType nbp = npart_ - nap;
-// 				s += comb_(nsite_,nap) * comb_(nsite_,nbp);
-// 			}
-// 			SizeType nb = npart_ - na;
-// 			s += perfectIndexPartial(ketA)*comb_(nsite_,nb);
-// 			s += perfectIndexPartial(ketB);
-// 			assert(s<reordering_.size());
-// 			assert(reordering_[s]<data_.size());
-// 			return reordering_[s];
+			if (npart_==0) {
+				if (ket!=0) throw std::runtime_error("BasisOneSpinImmm::perfectIndex\n");
+				return 0;
+			}
+
+			WordType ketA=0,ketB=0;
+			uncollateKet(ketA,ketB,ket);
+			SizeType na = PsimagLite::BitManip::count(ketA);
+			SizeType nb = PsimagLite::BitManip::count(ketB);
+			if (na+nb!=npart_) throw std::runtime_error("BasisOneSpinImmm::perfectIndex\n");
+
+			SizeType s = offsets_[na];
+			s += perfectIndexPartial(ketA)*comb_(nsite_,nb);
+			s += perfectIndexPartial(ketB);
+			assert(s<reordering_.size());
+			SizeType index = reordering_[s];
+			if (index>=data_.size() || data_[index]!=ket)
+				throw std::runtime_error("BasisOneSpinImmm::perfectIndex\n");
+
+			assert(index==perfectIndexScan(ket));
+			return index;
 		}
 
 		SizeType getN(WordType ket,SizeType site,SizeType orb) const
@@ -271,6 +276,15 @@ namespace LanczosPlusPlus {
 
 	private:
 
+		SizeType perfectIndexScan(WordType ket) const
+		{
+			for (SizeType i=0;i<data_.size();i++)
+				if (data_[i]==ket) return i;
+			print(std::cout,true);
+			assert(false);
+			return 0;
+		}
+
 		bool getBra(WordType& bra, const WordType& ket,SizeType what,SizeType i) const
 		{
 
@@ -474,6 +488,7 @@ namespace LanczosPlusPlus {
 		SizeType npart_;
 		PsimagLite::Vector<WordType>::Type data_;
 		PsimagLite::Vector<WordType>::Type reordering_;
+		PsimagLite::Vector<SizeType>::Type offsets_;
 
 	}; // class BasisOneSpinImmm
 
@@ -23,6 +23,10 @@ Please see full open source license included in file LICENSE.
 #include "BasisImmm.h"
 #include "SparseRowCached.h"
 #include "ParametersImmm.h"
+#include "ParallelHamiltonianSetup.h"
+#include "ParallelMatrixVectorProduct.h"
+#include "DiagonalCache.h"
+#include "BondList.h"
 
 namespace LanczosPlusPlus {
 
@@ -30,9 +34,14 @@ template<typename ComplexOrRealType,typename GeometryType,typename InputType>
 
 class Immm : public ModelBase<ComplexOrRealType,GeometryType,InputType> {
 
+	typedef Immm<ComplexOrRealType,GeometryType,InputType> ThisType;
 	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef ModelBase<ComplexOrRealType,GeometryType,InputType> BaseType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	friend class ParallelHamiltonianSetup<ThisType>;
+	friend class ParallelMatrixVectorProduct<ThisType>;
 
 	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
 
@@ -41,10 +50,14 @@ public:
 	typedef ParametersImmm<RealType> ParametersModelType;
 	typedef BasisImmm<GeometryType> BasisType;
 	typedef typename BasisType::BaseType BasisBaseType;
+	typedef DiagonalCache<RealType,BasisBaseType> DiagonalCacheType;
 	typedef typename BasisType::WordType WordType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
 	typedef typename BaseType::VectorType VectorType;
 	typedef PsimagLite::SparseRowCached<SparseMatrixType> SparseRowType;
+	typedef BondList<ComplexOrRealType,WordType> BondListType;
+
+	friend class DiagonalCache<RealType,BasisBaseType>;
 
 	static int const FERMION_SIGN = BasisType::FERMION_SIGN;
 
@@ -52,12 +65,31 @@ public:
 	     SizeType ndown,
 	     const ParametersModelType& mp,
 	     const GeometryType& geometry)
-	    : mp_(mp),geometry_(geometry),basis_(geometry,nup,ndown)
-	{}
-
-	~Immm()
+	    : mp_(mp),geometry_(geometry),basis_(geometry,nup,ndown),maxOrbitals_(0)
 	{
-		BaseType::deleteGarbage(garbage_);
+		SizeType nsite = geometry_.numberOfSites();
+		for (SizeType i=0;i<nsite;i++)
+			if (basis_.orbsPerSite(i) > maxOrbitals_) maxOrbitals_ = basis_.orbsPerSite(i);
+
+		// origin i*maxOrbitals_ + orb, closed also for orbitals i lacks
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb=0;orb<maxOrbitals_;orb++) {
+				for (SizeType j=i;j<nsite && orb<basis_.orbsPerSite(i);j++) {
+					for (SizeType orb2=0;orb2<basis_.orbsPerSite(j);orb2++)
+						hoppingBonds_.push(j,orb2,0,hoppings(i,orb,j,orb2));
+				}
+
+				hoppingBonds_.closeOrigin();
+			}
+
+			// by site; Upd couples Oxygen site i to Copper sites
+			for (SizeType j=0;j<nsite && basis_.orbsPerSite(i)!=1;j++) {
+				if (basis_.orbsPerSite(j)==2) continue;
+				updBonds_.push(j,0,0,Upd(i,j));
+			}
+
+			updBonds_.closeOrigin();
+		}
 	}
 
 	SizeType size() const { return basis_.size(); }
@@ -85,37 +117,17 @@ public:
 
 	void matrixVectorProduct(VectorType &x,const VectorType& y) const
 	{
-		matrixVectorProduct(x,y,basis_);
+		matrixVectorProduct(x,y,basis_,PsimagLite::Concurrency::npthreads);
 	}
 
 	void matrixVectorProduct(VectorType &x,
 	                         const VectorType& y,
-	                         const BasisBaseType& basis) const
+	                         const BasisBaseType& basis,
+	                         SizeType threads) const
 	{
-		// Calculate diagonal elements AND count non-zero matrix elements
-		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert);
-		calcDiagonalElements(diag,basis);
-
-		SizeType nsite = geometry_.numberOfSites();
-
-		// Calculate off-diagonal elements AND store matrix
-		SizeType cacheSize = hilbert/10;
-		if (cacheSize<100) cacheSize=100;
-		SparseRowType sparseRow(cacheSize);
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			WordType ket1 = basis.operator()(ispace,SPIN_UP);
-			WordType ket2 = basis.operator()(ispace,SPIN_DOWN);
-			// Save diagonal
-			sparseRow.add(ispace,diag[ispace]);
-			for (SizeType i=0;i<nsite;i++) {
-				for (SizeType orb=0;orb<basis.orbsPerSite(i);orb++) {
-					setHoppingTerm(sparseRow,ket1,ket2,ispace,i,orb,basis);
-				}
-			}
-
-			x[ispace] += sparseRow.matrixVectorProduct(y);
-		}
+		const VectorRealType& diag = diagonalCache_(*this,basis,threads);
+		ParallelMatrixVectorProduct<ThisType> parallelProduct(*this,diag,basis,threads);
+		parallelProduct(x,y);
 	}
 
 	const GeometryType& geometry() const { return geometry_; }
@@ -125,48 +137,64 @@ public:
 	void setupHamiltonian(SparseMatrixType& matrix,
 	                      const BasisBaseType& basis) const
 	{
-		// Calculate diagonal elements AND count non-zero matrix elements
 		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert);
+		VectorRealType diag(hilbert);
 		calcDiagonalElements(diag,basis);
 
-		SizeType nsite = geometry_.numberOfSites();
-
-		// Setup CRS matrix
-		matrix.resize(hilbert,hilbert);
-
-		// Calculate off-diagonal elements AND store matrix
-		SizeType nCounter=0;
-		SparseRowType sparseRow(100);
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			matrix.setRow(ispace,nCounter);
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			// Save diagonal
-			sparseRow.add(ispace,diag[ispace]);
-			for (SizeType i=0;i<nsite;i++) {
-				for (SizeType orb=0;orb<basis.orbsPerSite(i);orb++) {
-					setHoppingTerm(sparseRow,ket1,ket2,ispace,i,orb,basis);
-				}
-			}
-			nCounter += sparseRow.finalize(matrix);
-		}
-		matrix.setRow(hilbert,nCounter);
+		ParallelHamiltonianSetup<ThisType> parallelSetup(*this,diag,basis);
+		parallelSetup(matrix);
 	}
 
 	PsimagLite::String name() const { return __FILE__; }
 
-	BasisBaseType* createBasis(SizeType nup, SizeType ndown) const
+	BasisBaseType* newBasis(SizeType nup, SizeType ndown) const
 	{
-		BasisType* ptr = new BasisType(geometry_,nup,ndown);
-		garbage_.push_back(ptr);
-		return ptr;
+		return new BasisType(geometry_,nup,ndown);
 	}
 
 	void print(std::ostream& os) const { os<<mp_; }
 
 private:
 
+	// Pushes row ispace of the Hamiltonian into matrix, returns its nonzeros
+	SizeType setupRow(SparseMatrixType& matrix,
+	                  SizeType ispace,
+	                  const VectorRealType& diag,
+	                  const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SparseRowType sparseRow(100);
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		// Save diagonal
+		sparseRow.add(ispace,diag[ispace]);
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb=0;orb<basis.orbsPerSite(i);orb++) {
+				setHoppingTerm(sparseRow,ket1,ket2,ispace,i,orb,basis);
+			}
+		}
+
+		return sparseRow.finalize(matrix);
+	}
+
+	// Off-diagonal part of row ispace times y
+	ComplexOrRealType offDiagonalProduct(const VectorType& y,
+	                                     SizeType ispace,
+	                                     const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SparseRowType sparseRow(100);
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb=0;orb<basis.orbsPerSite(i);orb++) {
+				setHoppingTerm(sparseRow,ket1,ket2,ispace,i,orb,basis);
+			}
+		}
+
+		return sparseRow.matrixVectorProduct(y);
+	}
+
 	ComplexOrRealType hoppings(SizeType i,
 	                           SizeType orb1,
 	                           SizeType j,
@@ -194,36 +222,35 @@ private:
 		WordType s2i=(ket2 & BasisType::bitmask(ii));
 		if (s2i>0) s2i=1;
 
-		SizeType nsite = geometry_.numberOfSites();
-
 		// Hopping term
-		for (SizeType j=i;j<nsite;j++) {
-			for (SizeType orb2=0;orb2<basis.orbsPerSite(j);orb2++) {
-				SizeType jj = j*basis.orbs()+orb2;
-				ComplexOrRealType h = hoppings(i,orb,j,orb2);
-				if (PsimagLite::real(h) == 0 && PsimagLite::imag(h) == 0) continue;
-				WordType s1j= (ket1 & BasisType::bitmask(jj));
-				if (s1j>0) s1j=1;
-				WordType s2j= (ket2 & BasisType::bitmask(jj));
-				if (s2j>0) s2j=1;
-
-				if (s1i+s1j==1) {
-					WordType bra1= ket1 ^(BasisType::bitmask(ii)|BasisType::bitmask(jj));
-					SizeType temp = basis.perfectIndex(bra1,ispace,SPIN_UP);
-					RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
-					RealType tmp2 = basis.doSign(ket1,ket2,i,orb,j,orb2,SPIN_UP);
-					ComplexOrRealType cTemp = h*extraSign*tmp2;
-					sparseRow.add(temp,cTemp);
-				}
+		SizeType origin = i*maxOrbitals_ + orb;
+		for (SizeType k=hoppingBonds_.begin(origin);k<hoppingBonds_.end(origin);k++) {
+			const typename BondListType::Bond& bond = hoppingBonds_(k);
+			SizeType j = bond.site;
+			SizeType orb2 = bond.orb;
+			SizeType jj = j*basis.orbs()+orb2;
+			const ComplexOrRealType& h = bond.value;
+			WordType s1j= (ket1 & BasisType::bitmask(jj));
+			if (s1j>0) s1j=1;
+			WordType s2j= (ket2 & BasisType::bitmask(jj));
+			if (s2j>0) s2j=1;
+
+			if (s1i+s1j==1) {
+				WordType bra1= ket1 ^(BasisType::bitmask(ii)|BasisType::bitmask(jj));
+				SizeType temp = basis.perfectIndex(bra1,ispace,SPIN_UP);
+				RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
+				RealType tmp2 = basis.doSign(ket1,ket2,i,orb,j,orb2,SPIN_UP);
+				ComplexOrRealType cTemp = h*extraSign*tmp2;
+				sparseRow.add(temp,cTemp);
+			}
 
-				if (s2i+s2j==1) {
-					WordType bra2= ket2 ^(BasisType::bitmask(ii)|BasisType::bitmask(jj));
-					SizeType temp = basis.perfectIndex(bra2,ispace,SPIN_DOWN);
-					RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
-					RealType tmp2 = basis.doSign(ket1,ket2,i,orb,j,orb2,SPIN_DOWN);
-					ComplexOrRealType cTemp = h*extraSign*tmp2;
-					sparseRow.add(temp,cTemp);
-				}
+			if (s2i+s2j==1) {
+				WordType bra2= ket2 ^(BasisType::bitmask(ii)|BasisType::bitmask(jj));
+				SizeType temp = basis.perfectIndex(bra2,ispace,SPIN_DOWN);
+				RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
+				RealType tmp2 = basis.doSign(ket1,ket2,i,orb,j,orb2,SPIN_DOWN);
+				ComplexOrRealType cTemp = h*extraSign*tmp2;
+				sparseRow.add(temp,cTemp);
 			}
 		}
 	}
@@ -232,44 +259,45 @@ private:
 	                          const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
-		SizeType nsite = geometry_.numberOfSites();
+		for (SizeType ispace=0;ispace<hilbert;ispace++)
+			diag[ispace] = diagonalElement(ispace,basis);
+	}
 
-		// Calculate diagonal elements
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			ComplexOrRealType s=0;
-			for (SizeType i=0;i<nsite;i++) {
-				for (SizeType orb=0;orb<basis.orbsPerSite(i);orb++) {
-
-					SizeType totalCharge = basis.getN(ket1,ket1,i,SPIN_UP,orb) +
-					        basis.getN(ket2,ket2,i,SPIN_DOWN,orb);
-
-					// Hubbard term U0
-					assert(i < mp_.hubbardU.size());
-					s += mp_.hubbardU[i]*
-					        (1.0-basis.isThereAnElectronAt(ket1,ket2,i,SPIN_UP,orb))*
-					        (1.0-basis.isThereAnElectronAt(ket1,ket2,i,SPIN_DOWN,orb));
-
-					// Potential term
-					s += mp_.potentialV[i]*totalCharge;
-
-					// Upd n_O n_Cu
-					if (basis.orbsPerSite(i)==1) continue;
-					// i is an Oxygen site now
-					for (SizeType j=0;j<nsite;j++) {
-						if (basis.orbsPerSite(j)==2) continue;
-						// j is a Copper site now
-						SizeType totalCharge2 = basis.getN(ket1,ket1,j,SPIN_UP,0) +
-						        basis.getN(ket2,ket2,j,SPIN_DOWN,0);
-						s += (2.0-totalCharge) * (2.0-totalCharge2) * Upd(i,j);
-					}
+	RealType diagonalElement(SizeType ispace,const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		ComplexOrRealType s=0;
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb=0;orb<basis.orbsPerSite(i);orb++) {
+
+				SizeType totalCharge = basis.getN(ket1,ket1,i,SPIN_UP,orb) +
+				        basis.getN(ket2,ket2,i,SPIN_DOWN,orb);
+
+				// Hubbard term U0
+				assert(i < mp_.hubbardU.size());
+				s += mp_.hubbardU[i]*
+				        (1.0-basis.isThereAnElectronAt(ket1,ket2,i,SPIN_UP,orb))*
+				        (1.0-basis.isThereAnElectronAt(ket1,ket2,i,SPIN_DOWN,orb));
+
+				// Potential term
+				s += mp_.potentialV[i]*totalCharge;
+
+				// Upd n_O n_Cu
+				if (basis.orbsPerSite(i)==1) continue;
+				// i is an Oxygen site now; bonds go to Copper sites
+				for (SizeType k=updBonds_.begin(i);k<updBonds_.end(i);k++) {
+					SizeType j = updBonds_(k).site;
+					SizeType totalCharge2 = basis.getN(ket1,ket1,j,SPIN_UP,0) +
+					        basis.getN(ket2,ket2,j,SPIN_DOWN,0);
+					s += (2.0-totalCharge) * (2.0-totalCharge2) * updBonds_(k).value;
 				}
 			}
-
-			assert(fabs(PsimagLite::imag(s))<1e-12);
-			diag[ispace] = PsimagLite::real(s);
 		}
+
+		assert(fabs(PsimagLite::imag(s))<1e-12);
+		return PsimagLite::real(s);
 	}
 
 	//! Gf Related function:
@@ -289,7 +317,10 @@ private:
 	const ParametersModelType mp_;
 	const GeometryType& geometry_;
 	BasisType basis_;
-	mutable typename PsimagLite::Vector<BasisType*>::Type garbage_;
+	SizeType maxOrbitals_;
+	BondListType hoppingBonds_;
+	BondListType updBonds_;
+	mutable DiagonalCacheType diagonalCache_;
 }; // class Immm
 
 } // namespace LanczosPlusPlus
@@ -5,6 +5,7 @@
 #define BASIS_TJ_MULTIORB_LANCZOS_H
 
 #include "BitManip.h"
+#include "Matrix.h"
 #include "ProgramGlobals.h"
 #include "../../Engine/BasisBase.h"
 
@@ -35,17 +36,22 @@ public:
 	                       SizeType nup,
 	                       SizeType ndown,
 	                       SizeType orbitals)
-	    : geometry_(geometry),nup_(nup),ndown_(ndown),orbitals_(orbitals)
+	    : geometry_(geometry),nup_(nup),ndown_(ndown),orbitals_(orbitals),sizeUp_(0)
 	{
 		assert(bitmask_.size()==0 ||
 		       bitmask_.size()==geometry_.numberOfSites()*orbitals);
 		if (bitmask_.size()==0) doBitmask();
-		VectorWordType data1;
-		fillOneSector(data1,nup);
+		SizeType n = geometry_.numberOfSites()*orbitals_;
+		if (nup + ndown > n)
+			throw PsimagLite::RuntimeError("BasisTjMultiOrbLanczos: too many electrons\n");
+
+		doCombinatorial(n);
 		VectorWordType data2;
-		fillOneSector(data2,ndown);
-		combineAndFilter(data1,data2);
-		std::sort(data_.begin(),data_.end());
+		fillOneSector(data2,n,ndown);
+		VectorWordType holes;
+		fillOneSector(holes,n - ndown,nup);
+		sizeUp_ = holes.size();
+		generate(data2,holes);
 	}
 
 	static const WordType& bitmask(SizeType i)
@@ -66,59 +72,24 @@ public:
 	SizeType perfectIndex(const VectorWordType& kets) const
 	{
 		assert(kets.size()==2);
-		return (orbitals_ == 1) ? perfectIndex(kets[0],kets[1]) : bruteForce(kets[0],kets[1]);
+		return perfectIndex(kets[0],kets[1]);
 	}
 
+	// Lin index: rank of the down word times the number of allowed up
+	// words, plus the rank of the up word on the sites left empty by down
 	SizeType perfectIndex(WordType ket1,WordType ket2) const
 	{
-		if (orbitals_ > 1) return  bruteForce(ket1, ket2);
-
 		assert(SizeType(PsimagLite::BitManip::count(ket1))==nup_);
 		assert(SizeType(PsimagLite::BitManip::count(ket2))==ndown_);
-		SizeType n = geometry_.numberOfSites();
+		SizeType n = geometry_.numberOfSites()*orbitals_;
+		SizeType index = rank(ket2)*sizeUp_ + rank(compress(ket1,ket2,n));
 		WordType w = ket2;
 		w <<= n;
 		w |= ket1;
-		SizeType elements = data_.size();
-		SizeType i = elements/2;
-		SizeType start = 0;
-		SizeType end = elements;
-		SizeType counter = 0;
-		SizeType max = SizeType(0.1*elements);
-		if (max>100) max = 100;
-		if (max<1) max = 1;
-
-		while (counter<max) {
-			if (data_[i]==w) return i;
-			if (data_[i]>w) {
-				if (i<end) end = i;
-				i = i/2;
-			} else {
-				if (i>start) start = i;
-				i = (i+elements)/2;
-			}
-			counter++;
-		}
-
-		for (SizeType j=start;j<end;++j) {
-			if (data_[j] == w) return j;
-		}
+		if (index >= data_.size() || data_[index] != w)
+			throw PsimagLite::RuntimeError("BasisTjMultiOrbLanczos: ket not in basis\n");
 
-		assert(false);
-		return 0;
-	}
-
-	SizeType bruteForce(WordType ket1,WordType ket2) const
-	{
-		SizeType n = geometry_.numberOfSites()*orbitals_;
-		WordType ket = ket2;
-		ket <<= n;
-		ket |= ket1;
-		for (SizeType i = 0; i < data_.size(); ++i)
-			if (ket == data_[i]) return i;
-
-		assert(false);
-		return 0;
+		return index;
 	}
 
 	SizeType electrons(SizeType what) const
@@ -318,14 +289,10 @@ private:
 		return (tmp>0);
 	}
 
-	void fillOneSector(VectorWordType& data1,SizeType npart) const
+	void fillOneSector(VectorWordType& data1,SizeType levels,SizeType npart) const
 	{
 		/* compute size of basis */
-		SizeType hilbert=1;
-		int n=geometry_.numberOfSites()*orbitals_;
-		SizeType m=1;
-		for (;m<=npart;n--,m++)
-			hilbert=hilbert*n/m;
+		SizeType hilbert = comb_(levels,npart);
 
 		if (data1.size()!=hilbert) {
 			data1.clear();
@@ -341,7 +308,8 @@ private:
 		WordType ket = (1ul<<npart)-1;
 		for (SizeType i=0;i<hilbert;i++) {
 			data1[i] = ket;
-			n=m=0;
+			SizeType n=0;
+			SizeType m=0;
 			for (;(ket&3)!=1;n++,ket>>=1) {
 				m += ket&1;
 			}
@@ -349,20 +317,75 @@ private:
 		}
 	}
 
-	void combineAndFilter(const VectorWordType& data1,
-	                      const VectorWordType& data2)
+	// For each down word, in ascending order, places every up word of
+	// holes on the empty sites; no doubly occupied state is ever formed,
+	// and data_ comes out sorted
+	void generate(const VectorWordType& data2,const VectorWordType& holes)
 	{
-		WordType tmp = 0;
-		WordType tmp2 = 0;
-		SizeType n=geometry_.numberOfSites()*orbitals_;
-		for (SizeType i=0;i<data1.size();i++) {
-			for (SizeType j=0;j<data2.size();j++) {
-				tmp = (data1[i] & data2[j]);
-				if (tmp>0) continue; // there's one or more doubly occupied
-				tmp2 = data2[j];
-				tmp2 <<= n;
-				data_.push_back(tmp2 | data1[i]);
-			}
+		SizeType n = geometry_.numberOfSites()*orbitals_;
+		data_.resize(data2.size()*holes.size());
+		SizeType counter = 0;
+		for (SizeType j=0;j<data2.size();j++) {
+			WordType tmp2 = data2[j];
+			tmp2 <<= n;
+			for (SizeType i=0;i<holes.size();i++)
+				data_[counter++] = tmp2 | expand(holes[i],data2[j],n);
+		}
+	}
+
+	// Bits of ket on the sites not occupied by other, packed to the right
+	WordType compress(WordType ket,WordType other,SizeType n) const
+	{
+		WordType w = 0;
+		SizeType c = 0;
+		for (SizeType i=0;i<n;i++) {
+			if (other & bitmask_[i]) continue;
+			if (ket & bitmask_[i]) w |= bitmask_[c];
+			c++;
+		}
+
+		return w;
+	}
+
+	// Inverse of compress
+	WordType expand(WordType w,WordType other,SizeType n) const
+	{
+		WordType ket = 0;
+		SizeType c = 0;
+		for (SizeType i=0;i<n;i++) {
+			if (other & bitmask_[i]) continue;
+			if (w & bitmask_[c]) ket |= bitmask_[i];
+			c++;
+		}
+
+		return ket;
+	}
+
+	SizeType rank(WordType state) const
+	{
+		SizeType n=0;
+		for (SizeType b=0,c=1;state>0;b++,state>>=1)
+			if (state&1) n += comb_(b,c++);
+
+		return n;
+	}
+
+	void doCombinatorial(SizeType n)
+	{
+		/* look-up table for binomial coefficients */
+		comb_.reset(n+1,n+1);
+
+		for (SizeType i=0;i<comb_.n_row();i++)
+			for (SizeType j=0;j<comb_.n_col();j++)
+				comb_(i,j)=0;
+
+		for (SizeType i=0;i<comb_.n_row();i++) {
+			SizeType m = 0;
+			int j = i;
+			SizeType k = 1;
+			SizeType cnm  = 1;
+			for (;m<=i/2;m++,cnm=cnm*j/k,k++,j--)
+				comb_(i,m) = comb_(i,i-m) = cnm;
 		}
 	}
 
@@ -476,6 +499,8 @@ private:
 	SizeType nup_;
 	SizeType ndown_;
 	SizeType orbitals_;
+	SizeType sizeUp_;
+	PsimagLite::Matrix<SizeType> comb_;
 	VectorWordType data_;
 }; // class BasisTjMultiOrbLanczos
 
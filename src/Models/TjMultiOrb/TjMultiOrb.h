@@ -11,16 +11,25 @@
 #include "SparseRow.h"
 #include "ParametersTjMultiOrb.h"
 #include "ModelBase.h"
+#include "ParallelHamiltonianSetup.h"
+#include "ParallelMatrixVectorProduct.h"
+#include "DiagonalCache.h"
+#include "BondList.h"
 
 namespace LanczosPlusPlus {
 
 template<typename ComplexOrRealType,typename GeometryType,typename InputType>
 class TjMultiOrb  : public ModelBase<ComplexOrRealType,GeometryType,InputType> {
 
+	typedef TjMultiOrb<ComplexOrRealType,GeometryType,InputType> ThisType;
 	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
 	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
 	typedef std::pair<SizeType,SizeType> PairType;
 	typedef ModelBase<ComplexOrRealType,GeometryType,InputType> BaseType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	friend class ParallelHamiltonianSetup<ThisType>;
+	friend class ParallelMatrixVectorProduct<ThisType>;
 
 	enum {SPIN_UP = ProgramGlobals::SPIN_UP, SPIN_DOWN = ProgramGlobals::SPIN_DOWN};
 
@@ -32,7 +41,9 @@ public:
 	typedef ParametersTjMultiOrb<RealType,InputType> ParametersModelType;
 	typedef BasisTjMultiOrbLanczos<GeometryType> BasisType;
 	typedef typename BasisType::BaseType BasisBaseType;
+	typedef DiagonalCache<RealType,BasisBaseType> DiagonalCacheType;
 	typedef typename BasisType::WordType WordType;
+	typedef BondList<ComplexOrRealType,WordType> BondListType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
 	typedef typename BaseType::VectorType VectorType;
 	typedef typename BaseType::VectorSizeType VectorSizeType;
@@ -41,6 +52,8 @@ public:
 	typedef PsimagLite::Matrix<SizeType> MatrixSizeType;
 	typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
 
+	friend class DiagonalCache<RealType,BasisBaseType>;
+
 	static int const FERMION_SIGN = BasisType::FERMION_SIGN;
 
 	TjMultiOrb(SizeType nup,
@@ -75,14 +88,49 @@ public:
 				w_(i,j) = geometry_(i,0,j,0,3);
 			}
 		}
+
+		SizeType orbitals = mp_.orbitals;
+		for (SizeType i=0;i<n;i++) {
+			for (SizeType orb = 0; orb < orbitals; ++orb) {
+				SizeType ii = i*orbitals+orb;
+				for (SizeType j=i;j<n;j++) {
+					for (SizeType orb2 = 0; orb2 < orbitals; ++orb2) {
+						SizeType jj = j*orbitals+orb2;
+						WordType mask = BasisType::bitmask(ii) | BasisType::bitmask(jj);
+						hoppingBonds_.push(j,orb2,mask,hoppings_(i+j*n,orb+orb2*orbitals));
+						jPmBonds_.push(j,orb2,mask,jpm_(i,j));
+					}
+				}
+
+				hoppingBonds_.closeOrigin();
+				jPmBonds_.closeOrigin();
+			}
+
+			// by site; orbitals are looped over by diagonalElement
+			for (SizeType j=i+1;j<n;j++) {
+				jZzBonds_.push(j,0,0,jzz_(i,j));
+				wBonds_.push(j,0,0,w_(i,j));
+			}
+
+			jZzBonds_.closeOrigin();
+			wBonds_.closeOrigin();
+		}
+
+		if (mp_.reinterpretAndTruncate) addRotation(basis_);
 	}
 
 	~TjMultiOrb()
 	{
-		BaseType::deleteGarbage(garbage_);
+		for (SizeType i=0;i<rotations_.size();i++)
+			delete rotations_[i];
 	}
 
-	SizeType size() const { return basis_.size(); }
+	// With JHundInfinity=1 this is the size of the truncated space
+	SizeType size() const
+	{
+		if (!mp_.reinterpretAndTruncate) return basis_.size();
+		return rotation(basis_).truncatedSize;
+	}
 
 	SizeType orbitals(SizeType) const
 	{
@@ -99,33 +147,11 @@ public:
 	                      const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
-		typename PsimagLite::Vector<RealType>::Type diag(hilbert,0.0);
+		VectorRealType diag(hilbert,0.0);
 		calcDiagonalElements(diag,basis);
 
-		SizeType nsite = geometry_.numberOfSites();
-
-		matrix.resize(hilbert,hilbert);
-		// Calculate off-diagonal elements AND store matrix
-		SizeType nCounter=0;
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			SparseRowType sparseRow;
-			matrix.setRow(ispace,nCounter);
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			// Save diagonal
-			sparseRow.add(ispace,diag[ispace]);
-			for (SizeType i=0;i<nsite;i++) {
-				for (SizeType orb = 0; orb < mp_.orbitals; ++orb) {
-					setHoppingTerm(sparseRow,ket1,ket2,i,orb,basis);
-					setSplusSminus(sparseRow,ket1,ket2,i,orb,basis);
-				}
-			}
-
-			nCounter += sparseRow.finalize(matrix);
-		}
-
-		matrix.setRow(hilbert,nCounter);
-		matrix.checkValidity();
+		ParallelHamiltonianSetup<ThisType> parallelSetup(*this,diag,basis);
+		parallelSetup(matrix);
 		assert(isHermitian(matrix));
 
 		if (mp_.reinterpretAndTruncate)
@@ -162,19 +188,49 @@ public:
 
 	PsimagLite::String name() const { return __FILE__; }
 
-	BasisType* createBasis(SizeType nup, SizeType ndown) const
+	// With JHundInfinity=1 the rotation of the sector is made here, once,
+	// so that the products only read it
+	BasisType* newBasis(SizeType nup, SizeType ndown) const
+	{
+		BasisType* basis = new BasisType(geometry_,nup,ndown,mp_.orbitals);
+		if (mp_.reinterpretAndTruncate) addRotation(*basis);
+		return basis;
+	}
+
+	void matrixVectorProduct(VectorType &x,const VectorType& y) const
 	{
-		BasisType* ptr = new BasisType(geometry_,nup,ndown,mp_.orbitals);
-		garbage_.push_back(ptr);
-		return ptr;
+		matrixVectorProduct(x,y,basis_,PsimagLite::Concurrency::npthreads);
 	}
 
-	virtual void matrixVectorProduct(VectorType&,
-	                                 const VectorType&,
-	                                 const BasisBaseType&) const
+	void matrixVectorProduct(VectorType &x,
+	                         const VectorType& y,
+	                         const BasisBaseType& basis,
+	                         SizeType threads) const
 	{
-		throw PsimagLite::RuntimeError
-		        ("ModelBase::matrixVectorProduct(3) not impl. for this model\n");
+		SizeType hilbert=basis.size();
+		const VectorRealType& diag = diagonalCache_(*this,basis,threads);
+		ParallelMatrixVectorProduct<ThisType> parallelProduct(*this,diag,basis,threads);
+
+		if (!mp_.reinterpretAndTruncate) {
+			parallelProduct(x,y);
+			return;
+		}
+
+		// x += P rot H rotT P^T y, the same as reinterpretAndTruncate
+		const JHundInfinityRotation& r = rotation(basis);
+		assert(x.size() == r.truncatedSize && y.size() == r.truncatedSize);
+		VectorType yFull(hilbert,0.0);
+		for (SizeType i=0;i<hilbert;i++)
+			if (r.remap[i] < hilbert) yFull[i] = y[r.remap[i]];
+
+		VectorType tmp(hilbert,0.0);
+		r.rotT.matrixVectorProduct(tmp,yFull);
+		VectorType tmp2(hilbert,0.0);
+		parallelProduct(tmp2,tmp);
+		for (SizeType i=0;i<hilbert;i++) yFull[i] = 0.0;
+		r.rot.matrixVectorProduct(yFull,tmp2);
+		for (SizeType i=0;i<hilbert;i++)
+			if (r.remap[i] < hilbert) x[r.remap[i]] += yFull[i];
 	}
 
 	void print(std::ostream& os) const { os<<mp_; }
@@ -191,45 +247,132 @@ public:
 
 private:
 
-	void reinterpretAndTruncate(SparseMatrixType& matrix,
-	                            const BasisBaseType& basis) const
+	// Pushes row ispace of the Hamiltonian into matrix, returns its nonzeros
+	SizeType setupRow(SparseMatrixType& matrix,
+	                  SizeType ispace,
+	                  const VectorRealType& diag,
+	                  const BasisBaseType& basis) const
 	{
-		SizeType n = basis.size();
-		SparseMatrixType rot(n,n);
+		SizeType nsite = geometry_.numberOfSites();
+		SparseRowType sparseRow;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		// Save diagonal
+		sparseRow.add(ispace,diag[ispace]);
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb = 0; orb < mp_.orbitals; ++orb) {
+				setHoppingTerm(sparseRow,ket1,ket2,i,orb,basis);
+				setSplusSminus(sparseRow,ket1,ket2,i,orb,basis);
+			}
+		}
+
+		return sparseRow.finalize(matrix);
+	}
+
+	// JHundInfinity=1 rotation of one sector, kept for the on-the-fly product
+	struct JHundInfinityRotation {
+
+		JHundInfinityRotation(SizeType nup_,SizeType ndown_)
+		    : nup(nup_),ndown(ndown_),truncatedSize(0)
+		{}
+
+		SizeType nup;
+		SizeType ndown;
+		SparseMatrixType rot;
 		SparseMatrixType rotT;
+		// full index to truncated index, or remap.size() if truncated away
+		VectorSizeType remap;
+		SizeType truncatedSize;
+	};
+
+	// Off-diagonal part of row ispace times y
+	ComplexOrRealType offDiagonalProduct(const VectorType& y,
+	                                     SizeType ispace,
+	                                     const BasisBaseType& basis) const
+	{
+		SizeType nsite = geometry_.numberOfSites();
+		SparseRowType sparseRow;
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb = 0; orb < mp_.orbitals; ++orb) {
+				setHoppingTerm(sparseRow,ket1,ket2,i,orb,basis);
+				setSplusSminus(sparseRow,ket1,ket2,i,orb,basis);
+			}
+		}
+
+		return sparseRow.finalize(y);
+	}
+
+	// Rotation of the sector of basis, kept until the model is destroyed
+	void addRotation(const BasisBaseType& basis) const
+	{
+		SizeType nup = PsimagLite::BitManip::count(basis(0,SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis(0,SPIN_DOWN));
+		for (SizeType i=0;i<rotations_.size();i++)
+			if (rotations_[i]->nup == nup && rotations_[i]->ndown == ndown) return;
+
+		JHundInfinityRotation* r = new JHundInfinityRotation(nup,ndown);
+		SizeType n = basis.size();
+		r->rot.resize(n,n);
 		VectorSizeType targets;
-		buildRotation(rot,rotT,targets,basis);
+		buildRotation(r->rot,r->rotT,targets,basis);
+
+		// targets are in increasing order, so one pass finds the others
+		r->remap.resize(n,n);
+		SizeType ii = 0;
+		SizeType t = 0;
+		for (SizeType i = 0; i < n; ++i) {
+			if (t < targets.size() && targets[t] == i) {
+				t++;
+				continue;
+			}
+
+			r->remap[i] = ii++;
+		}
+
+		r->truncatedSize = ii;
+		rotations_.push_back(r);
+	}
+
+	const JHundInfinityRotation& rotation(const BasisBaseType& basis) const
+	{
+		SizeType nup = PsimagLite::BitManip::count(basis(0,SPIN_UP));
+		SizeType ndown = PsimagLite::BitManip::count(basis(0,SPIN_DOWN));
+		for (SizeType i=0;i<rotations_.size();i++)
+			if (rotations_[i]->nup == nup && rotations_[i]->ndown == ndown)
+				return *rotations_[i];
+
+		throw PsimagLite::RuntimeError("TjMultiOrb: no JHundInfinity rotation for sector\n");
+	}
+
+	void reinterpretAndTruncate(SparseMatrixType& matrix,
+	                            const BasisBaseType& basis) const
+	{
+		const JHundInfinityRotation& r = rotation(basis);
 		SparseMatrixType tmp;
-		multiply(tmp,matrix,rotT);
-		multiply(matrix,rot,tmp);
+		multiply(tmp,matrix,r.rotT);
+		multiply(matrix,r.rot,tmp);
 		assert(isHermitian(matrix));
-		truncateMatrix(matrix,targets);
+		truncateMatrix(matrix,r.remap,r.truncatedSize);
 		assert(isHermitian(matrix));
 	}
 
-	void truncateMatrix(SparseMatrixType& matrix,const VectorSizeType& targets) const
+	void truncateMatrix(SparseMatrixType& matrix,
+	                    const VectorSizeType& remap,
+	                    SizeType nTrunc) const
 	{
-		assert(matrix.row() > targets.size());
 		SizeType nFull = matrix.row();
-		SizeType nTrunc = matrix.row() - targets.size();
+		assert(remap.size() == nFull && nTrunc <= nFull);
 		SparseMatrixType matrix2(nTrunc,nTrunc);
 
-		VectorSizeType remap(nFull,0);
-		SizeType ii = 0;
-		for (SizeType i = 0; i < nFull; ++i) {
-			if (std::find(targets.begin(),targets.end(),i) != targets.end()) continue;
-			remap[i] = ii;
-			ii++;
-		}
-
-		assert(ii = nTrunc);
 		SizeType counter = 0;
 		for (SizeType i = 0; i < nFull; ++i) {
-			if (std::find(targets.begin(),targets.end(),i) != targets.end()) continue;
+			if (remap[i] == nFull) continue;
 			matrix2.setRow(remap[i],counter);
 			for (int k = matrix.getRowPtr(i); k < matrix.getRowPtr(i+1); ++k) {
 				SizeType col = matrix.getCol(k);
-				if (std::find(targets.begin(),targets.end(),col) != targets.end()) continue;
+				if (remap[col] == nFull) continue;
 				matrix2.pushCol(remap[col]);
 				matrix2.pushValue(matrix.getValue(k));
 				counter++;
@@ -388,12 +531,13 @@ private:
 			return;
 		}
 
-		BasisType*  basis = createBasis(nup-1, ndown);
+		const BasisBaseType* basis = BaseType::createBasis(nup-1, ndown);
 		VectorSizeType opt(2,0);
 		opt[0] = site;
 		opt[1] = spin;
 		MatrixType matrix;
 		setupOperator(matrix,*basis,"c",opt);
+		BaseType::releaseBasis(basis);
 		os<<"#Operator_c_"<<spin<<"_"<<site<<"\n";
 		os<<"#SectorDest 2 "<<(nup-1)<<" "<<ndown<<"\n";
 		os<<"#Matrix\n";
@@ -504,41 +648,52 @@ private:
 	                          const BasisBaseType& basis) const
 	{
 		SizeType hilbert=basis.size();
+		for (SizeType ispace=0;ispace<hilbert;ispace++)
+			diag[ispace] = diagonalElement(ispace,basis);
+	}
+
+	RealType diagonalElement(SizeType ispace,const BasisBaseType& basis) const
+	{
 		SizeType nsite = geometry_.numberOfSites();
+		WordType ket1 = basis(ispace,SPIN_UP);
+		WordType ket2 = basis(ispace,SPIN_DOWN);
+		ComplexOrRealType s=0;
+		for (SizeType i=0;i<nsite;i++) {
+			for (SizeType orb = 0; orb < mp_.orbitals; ++orb) {
+				int niup = basis.isThereAnElectronAt(ket1,ket2,i,SPIN_UP,orb);
+				int nidown = basis.isThereAnElectronAt(ket1,ket2,i,SPIN_DOWN,orb);
+
+				if (i < mp_.potentialV.size()) {
+					s += mp_.potentialV[i+orb*nsite]*niup;
+					s += mp_.potentialV[i+orb*nsite+mp_.orbitals*nsite]*nidown;
+				}
 
-		// Calculate diagonal elements
-		for (SizeType ispace=0;ispace<hilbert;ispace++) {
-			WordType ket1 = basis(ispace,SPIN_UP);
-			WordType ket2 = basis(ispace,SPIN_DOWN);
-			ComplexOrRealType s=0;
-			for (SizeType i=0;i<nsite;i++) {
-				for (SizeType orb = 0; orb < mp_.orbitals; ++orb) {
-					int niup = basis.isThereAnElectronAt(ket1,ket2,i,SPIN_UP,orb);
-					int nidown = basis.isThereAnElectronAt(ket1,ket2,i,SPIN_DOWN,orb);
-
-					if (i < mp_.potentialV.size()) {
-						s += mp_.potentialV[i+orb*nsite]*niup;
-						s += mp_.potentialV[i+orb*nsite+mp_.orbitals*nsite]*nidown;
-					}
+				for (SizeType k=jZzBonds_.begin(i);k<jZzBonds_.end(i);k++) {
+					SizeType j = jZzBonds_(k).site;
+					for (SizeType orb2 = 0; orb2 < mp_.orbitals; ++orb2) {
+						int njup = basis.isThereAnElectronAt(ket1,ket2,j,SPIN_UP,orb2);
+						int njdown = basis.isThereAnElectronAt(ket1,ket2,j,SPIN_DOWN,orb2);
 
-					for (SizeType j=i+1;j<nsite;j++) {
-						for (SizeType orb2 = 0; orb2 < mp_.orbitals; ++orb2) {
-							int njup = basis.isThereAnElectronAt(ket1,ket2,j,SPIN_UP,orb2);
-							int njdown = basis.isThereAnElectronAt(ket1,ket2,j,SPIN_DOWN,orb2);
+						// Sz Sz term:
+						s += (niup-nidown) * (njup - njdown)  * jZzBonds_(k).value*0.25;
+					}
+				}
 
-							// Sz Sz term:
-							s += (niup-nidown) * (njup - njdown)  * jzz_(i,j)*0.25;
+				for (SizeType k=wBonds_.begin(i);k<wBonds_.end(i);k++) {
+					SizeType j = wBonds_(k).site;
+					for (SizeType orb2 = 0; orb2 < mp_.orbitals; ++orb2) {
+						int njup = basis.isThereAnElectronAt(ket1,ket2,j,SPIN_UP,orb2);
+						int njdown = basis.isThereAnElectronAt(ket1,ket2,j,SPIN_DOWN,orb2);
 
-							// ni nj term
-							s+= (niup+nidown) * (njup + njdown) * w_(i,j);
-						}
+						// ni nj term
+						s+= (niup+nidown) * (njup + njdown) * wBonds_(k).value;
 					}
 				}
 			}
-
-			assert(fabs(PsimagLite::imag(s))<1e-12);
-			diag[ispace] = PsimagLite::real(s);
 		}
+
+		assert(fabs(PsimagLite::imag(s))<1e-12);
+		return PsimagLite::real(s);
 	}
 
 	void setHoppingTerm(SparseRowType &sparseRow,
@@ -553,38 +708,35 @@ private:
 		WordType s2i=(ket2 & BasisType::bitmask(i*mp_.orbitals+orb));
 		if (s2i>0) s2i=1;
 
-		SizeType nsite = geometry_.numberOfSites();
+		SizeType ii = i*mp_.orbitals+orb;
 
 		// Hopping term
-		for (SizeType j=0;j<nsite;j++) {
-			for (SizeType orb2 = 0; orb2 < mp_.orbitals; ++orb2) {
-				if (j<i) continue;
-				ComplexOrRealType h = hoppings_(i+j*nsite,orb+orb2*mp_.orbitals);
-				if (PsimagLite::real(h) == 0 && PsimagLite::imag(h) == 0) continue;
-				WordType s1j= (ket1 & BasisType::bitmask(j*mp_.orbitals+orb2));
-				if (s1j>0) s1j=1;
-				WordType s2j= (ket2 & BasisType::bitmask(j*mp_.orbitals+orb2));
-				if (s2j>0) s2j=1;
-
-				if (s1i+s1j==1 && !(s1j==0 && s2j>0) && !(s1j>0 && s2i>0)) {
-					WordType bra1= ket1 ^ (BasisType::bitmask(i*mp_.orbitals+orb)|
-					                       BasisType::bitmask(j*mp_.orbitals+orb2));
-					SizeType temp = basis.perfectIndex(bra1,ket2);
-					RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
-					RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_UP);
-					ComplexOrRealType cTemp = h*extraSign*tmp2;
-					sparseRow.add(temp,cTemp);
-				}
+		for (SizeType k=hoppingBonds_.begin(ii);k<hoppingBonds_.end(ii);k++) {
+			const typename BondListType::Bond& bond = hoppingBonds_(k);
+			SizeType j = bond.site;
+			SizeType orb2 = bond.orb;
+			const ComplexOrRealType& h = bond.value;
+			WordType s1j= (ket1 & BasisType::bitmask(j*mp_.orbitals+orb2));
+			if (s1j>0) s1j=1;
+			WordType s2j= (ket2 & BasisType::bitmask(j*mp_.orbitals+orb2));
+			if (s2j>0) s2j=1;
+
+			if (s1i+s1j==1 && !(s1j==0 && s2j>0) && !(s1j>0 && s2i>0)) {
+				WordType bra1= ket1 ^ bond.mask;
+				SizeType temp = basis.perfectIndex(bra1,ket2);
+				RealType extraSign = (s1i==1) ? FERMION_SIGN : 1;
+				RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_UP);
+				ComplexOrRealType cTemp = h*extraSign*tmp2;
+				sparseRow.add(temp,cTemp);
+			}
 
-				if (s2i+s2j==1 && !(s2j==0 && s1j>0) && !(s2j>0 && s1i>0)) {
-					WordType bra2= ket2 ^(BasisType::bitmask(i*mp_.orbitals+orb)|
-					                      BasisType::bitmask(j*mp_.orbitals+orb2));
-					SizeType temp = basis.perfectIndex(ket1,bra2);
-					RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
-					RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_DOWN);
-					ComplexOrRealType cTemp = h*extraSign*tmp2;
-					sparseRow.add(temp,cTemp);
-				}
+			if (s2i+s2j==1 && !(s2j==0 && s1j>0) && !(s2j>0 && s1i>0)) {
+				WordType bra2= ket2 ^ bond.mask;
+				SizeType temp = basis.perfectIndex(ket1,bra2);
+				RealType extraSign = (s2i==1) ? FERMION_SIGN : 1;
+				RealType tmp2 = basis_.doSign(ket1,ket2,i,orb,j,orb2,SPIN_DOWN);
+				ComplexOrRealType cTemp = h*extraSign*tmp2;
+				sparseRow.add(temp,cTemp);
 			}
 		}
 	}
@@ -601,42 +753,40 @@ private:
 		WordType s2i=(ket2 & BasisType::bitmask(i*mp_.orbitals+orb));
 		if (s2i>0) s2i=1;
 
-		SizeType nsite = geometry_.numberOfSites();
+		SizeType ii = i*mp_.orbitals+orb;
 
 		// Hopping term
-		for (SizeType j=0;j<nsite;j++) {
-			for (SizeType orb2 = 0; orb2 < mp_.orbitals; ++orb2) {
-				if (j<i) continue;
-				ComplexOrRealType h = jpm_(i,j)*0.5;
-				if (PsimagLite::real(h) == 0 && PsimagLite::imag(h) == 0) continue;
-				WordType s1j= (ket1 & BasisType::bitmask(j*mp_.orbitals+orb2));
-				if (s1j>0) s1j=1;
-				WordType s2j= (ket2 & BasisType::bitmask(j*mp_.orbitals+orb2));
-				if (s2j>0) s2j=1;
-
-				if (s1i==1 && s1j==0 && s2i==0 && s2j==1) {
-					WordType bra1= ket1 ^ BasisType::bitmask(i*mp_.orbitals+orb);
-					bra1 |= BasisType::bitmask(j*mp_.orbitals+orb2);
-					WordType bra2= ket2 | BasisType::bitmask(i*mp_.orbitals+orb);
-					bra2 ^= BasisType::bitmask(j*mp_.orbitals+orb2);
-					SizeType temp = basis.perfectIndex(bra1,bra2);
-					sparseRow.add(temp,h*signSplusSminus(i*mp_.orbitals+orb,
-					                                     j*mp_.orbitals+orb2,
-					                                     bra1,
-					                                     bra2));
-				}
+		for (SizeType k=jPmBonds_.begin(ii);k<jPmBonds_.end(ii);k++) {
+			SizeType j = jPmBonds_(k).site;
+			SizeType orb2 = jPmBonds_(k).orb;
+			ComplexOrRealType h = jPmBonds_(k).value*0.5;
+			WordType s1j= (ket1 & BasisType::bitmask(j*mp_.orbitals+orb2));
+			if (s1j>0) s1j=1;
+			WordType s2j= (ket2 & BasisType::bitmask(j*mp_.orbitals+orb2));
+			if (s2j>0) s2j=1;
+
+			if (s1i==1 && s1j==0 && s2i==0 && s2j==1) {
+				WordType bra1= ket1 ^ BasisType::bitmask(i*mp_.orbitals+orb);
+				bra1 |= BasisType::bitmask(j*mp_.orbitals+orb2);
+				WordType bra2= ket2 | BasisType::bitmask(i*mp_.orbitals+orb);
+				bra2 ^= BasisType::bitmask(j*mp_.orbitals+orb2);
+				SizeType temp = basis.perfectIndex(bra1,bra2);
+				sparseRow.add(temp,h*signSplusSminus(i*mp_.orbitals+orb,
+				                                     j*mp_.orbitals+orb2,
+				                                     bra1,
+				                                     bra2));
+			}
 
-				if (s1i==0 && s1j==1 && s2i==1 && s2j==0) {
-					WordType bra1= ket1 | BasisType::bitmask(i*mp_.orbitals+orb);
-					bra1 ^= BasisType::bitmask(j*mp_.orbitals+orb2);
-					WordType bra2= ket2 ^ BasisType::bitmask(i*mp_.orbitals+orb);
-					bra2 |= BasisType::bitmask(j*mp_.orbitals+orb2);
-					SizeType temp = basis.perfectIndex(bra1,bra2);
-					sparseRow.add(temp,h*signSplusSminus(i*mp_.orbitals+orb,
-					                                     j*mp_.orbitals+orb2,
-					                                     bra1,
-					                                     bra2));
-				}
+			if (s1i==0 && s1j==1 && s2i==1 && s2j==0) {
+				WordType bra1= ket1 | BasisType::bitmask(i*mp_.orbitals+orb);
+				bra1 ^= BasisType::bitmask(j*mp_.orbitals+orb2);
+				WordType bra2= ket2 ^ BasisType::bitmask(i*mp_.orbitals+orb);
+				bra2 |= BasisType::bitmask(j*mp_.orbitals+orb2);
+				SizeType temp = basis.perfectIndex(bra1,bra2);
+				sparseRow.add(temp,h*signSplusSminus(i*mp_.orbitals+orb,
+				                                     j*mp_.orbitals+orb2,
+				                                     bra1,
+				                                     bra2));
 			}
 		}
 	}
@@ -678,7 +828,12 @@ private:
 	PsimagLite::Matrix<ComplexOrRealType> jpm_;
 	PsimagLite::Matrix<ComplexOrRealType> jzz_;
 	PsimagLite::Matrix<ComplexOrRealType> w_;
-	mutable typename PsimagLite::Vector<BasisType*>::Type garbage_;
+	BondListType hoppingBonds_;
+	BondListType jPmBonds_;
+	BondListType jZzBonds_;
+	BondListType wBonds_;
+	mutable DiagonalCacheType diagonalCache_;
+	mutable typename PsimagLite::Vector<JHundInfinityRotation*>::Type rotations_;
 }; // class TjMultiOrb
 } // namespace LanczosPlusPlus
 #endif
@@ -34,6 +34,10 @@ PsimagLite::String license = "Copyright (c) 2009-2012, UT-Battelle, LLC\n"
 #include "DefaultSymmetry.h"
 #include "ReflectionSymmetry.h"
 #include "TranslationSymmetry.h"
+#include "SpinFlipSymmetry.h"
+#include "ParticleHoleSymmetry.h"
+#include "SymmetryGroup.h"
+#include "SymmetryDetector.h"
 #include "Tokenizer.h"
 #include "InputCheck.h"
 #include "ReducedDensityMatrix.h"
@@ -66,14 +70,19 @@ typedef ModelSelectorType::ModelBaseType ModelBaseType;
 struct LanczosOptions {
 
 	LanczosOptions()
-	    : split(-1),spins(1,PairType(0,0))
+	    : split(-1),densityOfStates(false),spins(1,PairType(0,0))
 	{}
 
 	int split;
+	bool densityOfStates;
 	PsimagLite::Vector<SizeType>::Type cicj;
 	PsimagLite::Vector<SizeType>::Type gf;
+	PsimagLite::Vector<SizeType>::Type greenMatrix;
+	PsimagLite::Vector<SizeType>::Type gfk;
+	PsimagLite::Vector<SizeType>::Type kpm;
 	PsimagLite::Vector<SizeType>::Type sites;
 	PsimagLite::Vector<PairType>::Type spins;
+	PsimagLite::String extraSolverOptions;
 
 }; // struct LanczosOptions
 
@@ -113,7 +122,7 @@ void mainLoop3(const ModelType& model,
 	typedef typename EngineType::TridiagonalMatrixType TridiagonalMatrixType;
 
 	const GeometryType& geometry = model.geometry();
-	EngineType engine(model,geometry.numberOfSites(),io);
+	EngineType engine(model,geometry.numberOfSites(),io,lanczosOptions.extraSolverOptions);
 
 	//! get the g.s.:
 	RealType Eg = engine.gsEnergy();
@@ -157,6 +166,68 @@ void mainLoop3(const ModelType& model,
 		cfCollection.save(ioOut);
 	}
 
+	for (SizeType gfi=0;gfi<lanczosOptions.gfk.size();gfi++) {
+		std::cout<<"#gf(k)\n";
+		typedef PsimagLite::ContinuedFraction<TridiagonalMatrixType>
+		        ContinuedFractionType;
+		typedef PsimagLite::ContinuedFractionCollection<ContinuedFractionType>
+		        ContinuedFractionCollectionType;
+
+		typename EngineType::VectorStringType vstr;
+		PsimagLite::IoSimple::Out ioOut(std::cout);
+		ContinuedFractionCollectionType cfCollection(PsimagLite::FREQ_REAL);
+		SizeType norbitals = maxOrbitals(model);
+		for (SizeType i=0;i<lanczosOptions.spins.size();i++) {
+			for (SizeType orb=0;orb<norbitals;orb++) {
+				engine.spectralFunctionK(cfCollection,
+				                         vstr,
+				                         lanczosOptions.gfk[gfi],
+				                         lanczosOptions.spins[i].first,
+				                         orb);
+			}
+		}
+
+		ioOut<<"#INDEXTOCF ";
+		for (SizeType i = 0; i < vstr.size(); ++i)
+			ioOut<<vstr[i]<<" ";
+		ioOut<<"\n";
+		cfCollection.save(ioOut);
+	}
+
+	for (SizeType kpmi=0;kpmi<lanczosOptions.kpm.size();kpmi++) {
+		io.read(lanczosOptions.sites,"TSPSites");
+		if (lanczosOptions.sites.size()==0)
+			throw std::runtime_error("No sites in input file!\n");
+		if (lanczosOptions.sites.size()==1)
+			lanczosOptions.sites.push_back(lanczosOptions.sites[0]);
+
+		std::cout<<"#gf(i="<<lanczosOptions.sites[0]<<",j=";
+		std::cout<<lanczosOptions.sites[1]<<")\n";
+		SizeType norbitals = maxOrbitals(model);
+		for (SizeType orb1=0;orb1<norbitals;orb1++) {
+			for (SizeType orb2=orb1;orb2<norbitals;orb2++) {
+				engine.kernelPolynomial(std::cout,
+				                        lanczosOptions.kpm[kpmi],
+				                        lanczosOptions.sites[0],
+				                        lanczosOptions.sites[1],
+				                        lanczosOptions.spins,
+				                        std::pair<SizeType,SizeType>(orb1,orb2));
+			}
+		}
+	}
+
+	if (lanczosOptions.densityOfStates)
+		engine.densityOfStates(std::cout);
+
+	for (SizeType gmi=0;gmi<lanczosOptions.greenMatrix.size();gmi++) {
+		for (SizeType i=0;i<lanczosOptions.spins.size();i++) {
+			std::cout<<"#GreenMatrix spin="<<lanczosOptions.spins[i].first<<"\n";
+			engine.greenMatrix(std::cout,
+			                   lanczosOptions.greenMatrix[gmi],
+			                   lanczosOptions.spins[i].first);
+		}
+	}
+
 	for (SizeType cicji=0;cicji<lanczosOptions.cicj.size();cicji++) {
 		SizeType cicjI = lanczosOptions.cicj[cicji];
 		SizeType total = geometry.numberOfSites();
@@ -190,7 +261,8 @@ void mainLoop2(const ModelType& model,
 {
 	PsimagLite::String tmp;
 	io.readline(tmp,"SolverOptions=");
-	bool onthefly = (tmp.find("InternalProductOnTheFly") != PsimagLite::String::npos);
+	bool onthefly = (tmp.find("InternalProductOnTheFly") != PsimagLite::String::npos ||
+	                 tmp.find("KroneckerProduct") != PsimagLite::String::npos);
 
 	if (onthefly) {
 		mainLoop3<ModelType,SpecialSymmetryType,InternalProductOnTheFly>(model,
@@ -223,7 +295,46 @@ void mainLoop(InputNgType::Readable& io,
 
 	bool useReflectionSymmetry = (tmp==1) ? true : false;
 
-	if (useTranslationSymmetry) {
+	tmp = 0;
+	try {
+		io.readline(tmp,"UseSpinFlipSymmetry=");
+	} catch(std::exception& e) {}
+
+	bool useSpinFlipSymmetry = (tmp==1) ? true : false;
+
+	tmp = 0;
+	try {
+		io.readline(tmp,"UseParticleHoleSymmetry=");
+	} catch(std::exception& e) {}
+
+	bool useParticleHoleSymmetry = (tmp==1) ? true : false;
+
+	tmp = 0;
+	try {
+		io.readline(tmp,"UseSymmetryGroup=");
+	} catch(std::exception& e) {}
+
+	bool useSymmetryGroup = (tmp==1) ? true : false;
+
+	tmp = 0;
+	try {
+		io.readline(tmp,"AutoSymmetry=");
+	} catch(std::exception& e) {}
+
+	bool noSymmetry = !(useSymmetryGroup || useTranslationSymmetry ||
+	                    useReflectionSymmetry || useSpinFlipSymmetry ||
+	                    useParticleHoleSymmetry);
+	if (tmp==1 && noSymmetry) {
+		SymmetryDetector<ModelType> symmetryDetector(model);
+		lanczosOptions.extraSolverOptions = symmetryDetector.generators();
+		useSymmetryGroup = (lanczosOptions.extraSolverOptions != "");
+	}
+
+	if (useSymmetryGroup) {
+		mainLoop2<ModelType,SymmetryGroup<GeometryType,BasisBaseType> >(model,
+		                                                               io,
+		                                                               lanczosOptions);
+	} else if (useTranslationSymmetry) {
 		mainLoop2<ModelType,TranslationSymmetry<GeometryType,BasisBaseType> >(model,
 		                                                                      io,
 		                                                                      lanczosOptions);
@@ -231,6 +342,14 @@ void mainLoop(InputNgType::Readable& io,
 		mainLoop2<ModelType,ReflectionSymmetry<GeometryType,BasisBaseType> >(model,
 		                                                                     io,
 		                                                                     lanczosOptions);
+	} else if (useSpinFlipSymmetry) {
+		mainLoop2<ModelType,SpinFlipSymmetry<GeometryType,BasisBaseType> >(model,
+		                                                                   io,
+		                                                                   lanczosOptions);
+	} else if (useParticleHoleSymmetry) {
+		mainLoop2<ModelType,ParticleHoleSymmetry<GeometryType,BasisBaseType> >(model,
+		                                                                       io,
+		                                                                       lanczosOptions);
 	} else {
 		mainLoop2<ModelType,DefaultSymmetry<GeometryType,BasisBaseType> >(model,
 		                                                                  io,
@@ -251,6 +370,12 @@ int main(int argc,char *argv[])
 	/* PSIDOC LanczosDriver
 	\begin{itemize}
 	\item[-g label] Computes the spectral function (continued fraction) for label.
+	\item[-k label] Computes the spectral function for label at each momentum
+	$k=2\pi m/L$, one continued fraction per k and part.
+	\item[-K label] As -g, with the kernel polynomial method.
+	\item[-D] Computes the density of states with the kernel polynomial method.
+	\item[-G label] Computes the Green function of label for all pairs of
+	sites and orbitals, with band Lanczos from a single ground state.
 	\item[-c label] Computes the two-point correlation for label.
 	\item[-f file] Input file to use. DMRG++ inputs can be used.
 	\item[-s ``s1,s2''] computes correlations or spectral functions for spin s1,s2.
@@ -261,11 +386,23 @@ int main(int argc,char *argv[])
 	\item[-V] prints version and exits.
 	\end{itemize}
 	*/
-	while ((opt = getopt(argc, argv, "g:c:f:s:r:p:V")) != -1) {
+	while ((opt = getopt(argc, argv, "g:G:k:K:Dc:f:s:r:p:V")) != -1) {
 		switch (opt) {
 		case 'g':
 			lanczosOptions.gf.push_back(ProgramGlobals::operator2id(optarg));
 			break;
+		case 'G':
+			lanczosOptions.greenMatrix.push_back(ProgramGlobals::operator2id(optarg));
+			break;
+		case 'k':
+			lanczosOptions.gfk.push_back(ProgramGlobals::operator2id(optarg));
+			break;
+		case 'K':
+			lanczosOptions.kpm.push_back(ProgramGlobals::operator2id(optarg));
+			break;
+		case 'D':
+			lanczosOptions.densityOfStates = true;
+			break;
 		case 'f':
 			file = optarg;
 			break;